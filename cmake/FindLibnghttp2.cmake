@@ -0,0 +1,22 @@
+FIND_PATH(LIBNGHTTP2_INCLUDE_DIR nghttp2/nghttp2.h /usr/local/include /opt/local/include /usr/include)
+FIND_LIBRARY(LIBNGHTTP2_LIBRARY NAMES libnghttp2.a libnghttp2.so PATH /usr/local/lib /opt/local/lib /usr/lib)
+
+IF (LIBNGHTTP2_INCLUDE_DIR AND LIBNGHTTP2_LIBRARY)
+    SET(LIBNGHTTP2_FOUND TRUE)
+ENDIF ()
+
+IF (LIBNGHTTP2_FOUND)
+    IF (NOT Libnghttp2_FIND_QUIETLY)
+        MESSAGE(STATUS "Found libnghttp2: ${LIBNGHTTP2_LIBRARY}")
+    ENDIF ()
+ELSE()
+    IF (Libnghttp2_FIND_REQUIRED)
+        IF(NOT LIBNGHTTP2_INCLUDE_DIR)
+            MESSAGE(FATAL_ERROR "Could not find libnghttp2 header file!")
+        ENDIF()
+
+        IF(NOT LIBNGHTTP2_LIBRARY)
+            MESSAGE(FATAL_ERROR "Could not find libnghttp2 library file!")
+        ENDIF()
+    ENDIF ()
+ENDIF ()
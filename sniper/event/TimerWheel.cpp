@@ -0,0 +1,192 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sniper/std/check.h>
+#include "TimerWheel.h"
+
+namespace sniper::event {
+
+WheelTimer::~WheelTimer() noexcept
+{
+    stop();
+}
+
+void WheelTimer::start(TimerWheel& wheel, milliseconds timeout, bool repeat) noexcept
+{
+    stop();
+
+    _wheel = &wheel;
+    _ticks = std::max<uint64_t>(1, (timeout.count() + wheel._resolution.count() - 1) / wheel._resolution.count());
+    _repeat = repeat;
+    _wheel->add(*this);
+}
+
+void WheelTimer::again() noexcept
+{
+    if (!_wheel)
+        return;
+
+    // timer stays in earlier slot and is moved when that slot is processed
+    if (is_active())
+        _expire = _wheel->now_tick() + _ticks + 1;
+    else
+        _wheel->add(*this);
+}
+
+void WheelTimer::stop() noexcept
+{
+    if (is_active())
+        _wheel->remove(*this);
+}
+
+bool WheelTimer::is_active() const noexcept
+{
+    return next != nullptr;
+}
+
+TimerWheel::TimerWheel(loop_ptr loop, milliseconds resolution, uint32_t slots) :
+    _loop(std::move(loop)), _resolution(resolution)
+{
+    check(_loop, "[TimerWheel] loop is nullptr");
+    check(_resolution > 0ms, "[TimerWheel] resolution must be positive");
+    check(slots && !(slots & (slots - 1)), "[TimerWheel] slots count must be power of 2");
+
+    _mask = slots - 1;
+    _slots.resize(slots);
+    for (auto& s : _slots)
+        s.prev = s.next = &s;
+
+    _w.set(*_loop);
+    _w.set<TimerWheel, &TimerWheel::cb_tick>(this);
+}
+
+TimerWheel::~TimerWheel() noexcept
+{
+    _w.stop();
+
+    for (auto& s : _slots)
+        while (s.next != &s)
+            unlink(static_cast<WheelTimer&>(*s.next));
+}
+
+milliseconds TimerWheel::resolution() const noexcept
+{
+    return _resolution;
+}
+
+size_t TimerWheel::size() const noexcept
+{
+    return _size;
+}
+
+uint64_t TimerWheel::now_tick() const noexcept
+{
+    return static_cast<uint64_t>(_loop->now() * 1000.0) / _resolution.count();
+}
+
+void TimerWheel::add(WheelTimer& t) noexcept
+{
+    auto now = now_tick();
+
+    // ticks were not counted while wheel was empty
+    if (!_size) {
+        _tick = now;
+
+        double to_d = (double)_resolution.count() / 1000.0;
+        _w.start(to_d, to_d);
+    }
+
+    // +1: current tick is partially elapsed
+    t._expire = now + t._ticks + 1;
+    link(t);
+    _size++;
+}
+
+void TimerWheel::link(WheelTimer& t) noexcept
+{
+    auto& slot = _slots[t._expire & _mask];
+    t.prev = slot.prev;
+    t.next = &slot;
+    slot.prev->next = &t;
+    slot.prev = &t;
+}
+
+void TimerWheel::unlink(WheelTimer& t) noexcept
+{
+    t.prev->next = t.next;
+    t.next->prev = t.prev;
+    t.prev = t.next = nullptr;
+}
+
+void TimerWheel::remove(WheelTimer& t) noexcept
+{
+    unlink(t);
+
+    if (!--_size)
+        _w.stop();
+}
+
+void TimerWheel::process(detail::WheelLink& slot, uint64_t now) noexcept
+{
+    // move slot out: callbacks and relinked timers do not touch the list being walked
+    detail::WheelLink head;
+    if (slot.next == &slot)
+        return;
+
+    head.next = slot.next;
+    head.prev = slot.prev;
+    head.next->prev = &head;
+    head.prev->next = &head;
+    slot.prev = slot.next = &slot;
+
+    while (head.next != &head) {
+        auto& t = static_cast<WheelTimer&>(*head.next);
+        unlink(t);
+
+        // refreshed by again() or not yet due after full turn
+        if (t._expire > now) {
+            link(t);
+            continue;
+        }
+
+        if (t._repeat) {
+            t._expire = now + t._ticks;
+            link(t);
+        }
+        else if (!--_size) {
+            _w.stop();
+        }
+
+        t._cb(t);
+    }
+}
+
+void TimerWheel::cb_tick(ev::timer& w, int revents) noexcept
+{
+    auto now = now_tick();
+
+    // after long loop iteration each slot is processed once, expiration is checked per timer
+    auto count = std::min(now - _tick, _mask + 1);
+    for (uint64_t i = 1; i <= count && _size; i++)
+        process(_slots[(_tick + i) & _mask], now);
+
+    _tick = now;
+}
+
+} // namespace sniper::event
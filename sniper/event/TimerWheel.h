@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sniper/event/Loop.h>
+#include <sniper/std/chrono.h>
+#include <sniper/std/vector.h>
+
+namespace sniper::event {
+
+class TimerWheel;
+
+namespace detail {
+
+struct WheelLink
+{
+    WheelLink* prev = nullptr;
+    WheelLink* next = nullptr;
+};
+
+} // namespace detail
+
+// Timeout in TimerWheel. Callback is set like for ev++ watchers:
+//   _w_timeout.set<Connection, &Connection::cb_timeout>(this);
+//   _w_timeout.start(wheel, 1min, true);
+class WheelTimer final : private detail::WheelLink
+{
+public:
+    WheelTimer() = default;
+    WheelTimer(const WheelTimer&) = delete;
+    WheelTimer& operator=(const WheelTimer&) = delete;
+    ~WheelTimer() noexcept;
+
+    template<class K, void (K::*method)(WheelTimer&)>
+    void set(K* object) noexcept;
+
+    // repeat: restart with same timeout before callback
+    void start(TimerWheel& wheel, milliseconds timeout, bool repeat = false) noexcept;
+
+    // restart with last timeout, active timer is only marked (no relink)
+    void again() noexcept;
+    void stop() noexcept;
+    [[nodiscard]] bool is_active() const noexcept;
+
+private:
+    friend class TimerWheel;
+
+    template<class K, void (K::*method)(WheelTimer&)>
+    static void method_thunk(WheelTimer& w);
+
+    TimerWheel* _wheel = nullptr;
+    uint64_t _expire = 0;
+    uint64_t _ticks = 0;
+    bool _repeat = false;
+    void* _data = nullptr;
+    void (*_cb)(WheelTimer&) = nullptr;
+};
+
+// Hashed timer wheel: O(1) start/again/stop for many timeouts of the same order
+// (keep-alive, read and response timeouts). One ev::timer per wheel ticks with given resolution
+// while there are active timers. Callbacks are called not earlier than timeout and at most one tick later.
+class TimerWheel final
+{
+public:
+    explicit TimerWheel(loop_ptr loop, milliseconds resolution = 100ms, uint32_t slots = 1024);
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+    ~TimerWheel() noexcept;
+
+    [[nodiscard]] milliseconds resolution() const noexcept;
+    [[nodiscard]] size_t size() const noexcept;
+
+private:
+    friend class WheelTimer;
+
+    void add(WheelTimer& t) noexcept;
+    void link(WheelTimer& t) noexcept;
+    static void unlink(WheelTimer& t) noexcept;
+    void remove(WheelTimer& t) noexcept;
+    void process(detail::WheelLink& slot, uint64_t now) noexcept;
+    [[nodiscard]] uint64_t now_tick() const noexcept;
+
+    void cb_tick(ev::timer& w, [[maybe_unused]] int revents) noexcept;
+
+    loop_ptr _loop;
+    milliseconds _resolution;
+    uint64_t _mask = 0;
+    uint64_t _tick = 0; // last processed tick
+    size_t _size = 0;
+    vector<detail::WheelLink> _slots;
+    ev::timer _w;
+};
+
+template<class K, void (K::*method)(WheelTimer&)>
+void WheelTimer::set(K* object) noexcept
+{
+    _data = object;
+    _cb = &method_thunk<K, method>;
+}
+
+template<class K, void (K::*method)(WheelTimer&)>
+void WheelTimer::method_thunk(WheelTimer& w)
+{
+    (static_cast<K*>(w._data)->*method)(w);
+}
+
+} // namespace sniper::event
@@ -0,0 +1,542 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstring>
+#include <sniper/log/log.h>
+#include <sniper/std/check.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "Uring.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define SNIPER_IO_URING 1
+#include <linux/io_uring.h>
+#endif
+
+namespace sniper::event {
+
+#ifdef SNIPER_IO_URING
+
+namespace {
+
+constexpr uint64_t user_data_op_mask = 7;
+constexpr uint64_t user_data_tag_shift = 48;
+constexpr uint64_t user_data_ptr_mask = ((1ull << user_data_tag_shift) - 1) & ~user_data_op_mask;
+
+constexpr uint16_t buf_group = 0;
+
+int sys_setup(unsigned entries, io_uring_params* p) noexcept
+{
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+int sys_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, void* arg, size_t arg_size) noexcept
+{
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, arg_size);
+}
+
+int sys_register(int fd, unsigned opcode, void* arg, unsigned nr_args) noexcept
+{
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+template<typename T>
+inline T* ptr_at(void* base, uint32_t offset) noexcept
+{
+    return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+
+} // namespace
+
+Uring::Uring(loop_ptr loop, unsigned entries) : _loop(std::move(loop))
+{
+    check(_loop, "[Uring] loop is nullptr");
+
+    _w_submit.set(*_loop);
+    _w_submit.set<Uring, &Uring::cb_submit>(this);
+    _w_complete.set(*_loop);
+    _w_complete.set<Uring, &Uring::cb_complete>(this);
+
+    io_uring_params p{};
+    p.flags = IORING_SETUP_CLAMP | IORING_SETUP_CQSIZE;
+    p.cq_entries = entries * 4; // multishot operations produce many completions per sqe
+
+    if (_fd = sys_setup(entries, &p); _fd < 0) {
+        log_warn("[Uring] io_uring_setup error: {}", strerror(errno));
+        return;
+    }
+
+    if (!(p.features & IORING_FEAT_NODROP)) {
+        log_warn("[Uring] kernel is too old");
+        close();
+        return;
+    }
+
+    _sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    _cq_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        _sq_size = _cq_size = std::max(_sq_size, _cq_size);
+
+    _sq_ptr = mmap(nullptr, _sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+    if (_sq_ptr == MAP_FAILED) {
+        _sq_ptr = nullptr;
+        close();
+        return;
+    }
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        _cq_ptr = _sq_ptr;
+    }
+    else {
+        _cq_ptr = mmap(nullptr, _cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_CQ_RING);
+        if (_cq_ptr == MAP_FAILED) {
+            _cq_ptr = nullptr;
+            close();
+            return;
+        }
+    }
+
+    _sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+    auto* sqes = mmap(nullptr, _sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        close();
+        return;
+    }
+    _sqes = static_cast<io_uring_sqe*>(sqes);
+
+    _sq_head = ptr_at<unsigned>(_sq_ptr, p.sq_off.head);
+    _sq_tail = ptr_at<unsigned>(_sq_ptr, p.sq_off.tail);
+    _sq_flags = ptr_at<unsigned>(_sq_ptr, p.sq_off.flags);
+    _sq_mask = *ptr_at<unsigned>(_sq_ptr, p.sq_off.ring_mask);
+    _sq_entries = p.sq_entries;
+    _sq_local_tail = _sq_submitted = *_sq_tail;
+
+    // sqe index == array index
+    auto* array = ptr_at<unsigned>(_sq_ptr, p.sq_off.array);
+    for (unsigned i = 0; i < p.sq_entries; i++)
+        array[i] = i;
+
+    _cq_head = ptr_at<unsigned>(_cq_ptr, p.cq_off.head);
+    _cq_tail = ptr_at<unsigned>(_cq_ptr, p.cq_off.tail);
+    _cq_mask = *ptr_at<unsigned>(_cq_ptr, p.cq_off.ring_mask);
+    _cqes = ptr_at<io_uring_cqe>(_cq_ptr, p.cq_off.cqes);
+
+    _w_complete.start(_fd, ev::READ);
+}
+
+Uring::~Uring() noexcept
+{
+    close(0ms);
+}
+
+bool Uring::is_ready() const noexcept
+{
+    return _fd >= 0 && _sqes;
+}
+
+void Uring::close(milliseconds timeout) noexcept
+{
+    _w_submit.stop();
+    _w_complete.stop();
+
+    if (is_ready()) {
+        // in-flight operations hold references to their handlers, let them complete
+        auto deadline = steady_clock::now() + timeout;
+        while (_inflight && steady_clock::now() < deadline) {
+            if (!submit(true))
+                break;
+
+            reap();
+        }
+
+        if (_inflight)
+            log_warn("[Uring] close with {} in-flight operations", _inflight);
+    }
+
+    // started again by operations queued while draining
+    _w_submit.stop();
+
+    if (_br_ptr) {
+        if (_fd >= 0) {
+            io_uring_buf_reg reg{};
+            reg.bgid = buf_group;
+            sys_register(_fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+        }
+
+        munmap(_br_ptr, _br_size);
+        _br_ptr = nullptr;
+    }
+
+    if (_sqes) {
+        munmap(_sqes, _sqes_size);
+        _sqes = nullptr;
+    }
+
+    if (_cq_ptr && _cq_ptr != _sq_ptr)
+        munmap(_cq_ptr, _cq_size);
+    _cq_ptr = nullptr;
+
+    if (_sq_ptr) {
+        munmap(_sq_ptr, _sq_size);
+        _sq_ptr = nullptr;
+    }
+
+    if (_fd >= 0) {
+        ::close(_fd);
+        _fd = -1;
+    }
+
+    _inflight = 0;
+}
+
+io_uring_sqe* Uring::get_sqe() noexcept
+{
+    if (!is_ready())
+        return nullptr;
+
+    if (_sq_local_tail - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE) >= _sq_entries) {
+        // queue is full: flush it now
+        if (!submit() || _sq_local_tail - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE) >= _sq_entries)
+            return nullptr;
+    }
+
+    auto* sqe = &_sqes[_sq_local_tail & _sq_mask];
+    memset(sqe, 0, sizeof(io_uring_sqe));
+    _sq_local_tail++;
+    _inflight++;
+
+    if (!_w_submit.is_active())
+        _w_submit.start();
+
+    return sqe;
+}
+
+void Uring::set_data(io_uring_sqe* sqe, UringHandler* h, uint8_t op, uint16_t tag) noexcept
+{
+    sqe->user_data = reinterpret_cast<uint64_t>(h) | (op & user_data_op_mask) | ((uint64_t)tag << user_data_tag_shift);
+}
+
+bool Uring::prep_accept_multishot(int fd, UringHandler* h, uint8_t op, uint16_t tag) noexcept
+{
+    auto* sqe = get_sqe();
+    if (!sqe)
+        return false;
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    set_data(sqe, h, op, tag);
+
+    return true;
+}
+
+bool Uring::prep_recv_multishot(int fd, UringHandler* h, uint8_t op, uint16_t tag) noexcept
+{
+    if (!_br_ptr)
+        return false;
+
+    auto* sqe = get_sqe();
+    if (!sqe)
+        return false;
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = buf_group;
+    set_data(sqe, h, op, tag);
+
+    return true;
+}
+
+bool Uring::prep_sendmsg(int fd, const msghdr* msg, UringHandler* h, uint8_t op, uint16_t tag) noexcept
+{
+    auto* sqe = get_sqe();
+    if (!sqe)
+        return false;
+
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(msg);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    set_data(sqe, h, op, tag);
+
+    return true;
+}
+
+bool Uring::prep_cancel(UringHandler* h, uint8_t op, uint16_t tag) noexcept
+{
+    auto* sqe = get_sqe();
+    if (!sqe)
+        return false;
+
+    io_uring_sqe target{};
+    set_data(&target, h, op, tag);
+
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = target.user_data;
+    set_data(sqe, nullptr, 0, 0);
+
+    return true;
+}
+
+bool Uring::setup_buf_ring(unsigned entries) noexcept
+{
+    if (!is_ready() || _br_ptr || !entries || entries > 32768 || (entries & (entries - 1)))
+        return false;
+
+    _br_size = entries * sizeof(io_uring_buf);
+    auto* ptr = mmap(nullptr, _br_size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (ptr == MAP_FAILED)
+        return false;
+
+    io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<uint64_t>(ptr);
+    reg.ring_entries = entries;
+    reg.bgid = buf_group;
+
+    if (sys_register(_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        log_warn("[Uring] cannot register buffer ring: {}", strerror(errno));
+        munmap(ptr, _br_size);
+        return false;
+    }
+
+    _br_ptr = ptr;
+    _br_mask = entries - 1;
+    _br_tail = 0;
+
+    return true;
+}
+
+void Uring::add_buf(void* addr, uint32_t len, uint16_t bid) noexcept
+{
+    if (!_br_ptr)
+        return;
+
+    auto* buf = static_cast<io_uring_buf*>(_br_ptr) + (_br_tail & _br_mask);
+    buf->addr = reinterpret_cast<uint64_t>(addr);
+    buf->len = len;
+    buf->bid = bid;
+    _br_tail++;
+}
+
+void Uring::commit_bufs() noexcept
+{
+    if (!_br_ptr)
+        return;
+
+    // ring tail overlaps resv field of the first buffer
+    auto* tail = reinterpret_cast<uint16_t*>(static_cast<char*>(_br_ptr) + offsetof(io_uring_buf, resv));
+    __atomic_store_n(tail, _br_tail, __ATOMIC_RELEASE);
+}
+
+bool Uring::has_buffer(uint32_t flags) noexcept
+{
+    return flags & IORING_CQE_F_BUFFER;
+}
+
+uint16_t Uring::buffer_id(uint32_t flags) noexcept
+{
+    return flags >> IORING_CQE_BUFFER_SHIFT;
+}
+
+bool Uring::has_more(uint32_t flags) noexcept
+{
+    return flags & IORING_CQE_F_MORE;
+}
+
+bool Uring::submit(bool wait) noexcept
+{
+    unsigned to_submit = _sq_local_tail - _sq_submitted;
+    __atomic_store_n(_sq_tail, _sq_local_tail, __ATOMIC_RELEASE);
+
+    unsigned flags = 0;
+    if (wait || (__atomic_load_n(_sq_flags, __ATOMIC_RELAXED) & IORING_SQ_CQ_OVERFLOW))
+        flags |= IORING_ENTER_GETEVENTS;
+
+    if (!to_submit && !flags)
+        return true;
+
+    __kernel_timespec ts{0, 10 * 1000 * 1000};
+    io_uring_getevents_arg arg{};
+    arg.ts = reinterpret_cast<uint64_t>(&ts);
+
+    for (bool reaped = false;;) {
+        int rc = wait ? sys_enter(_fd, to_submit, 1, flags | IORING_ENTER_EXT_ARG, &arg, sizeof(arg))
+                      : sys_enter(_fd, to_submit, 0, flags, nullptr, 0);
+
+        if (rc >= 0) {
+            _sq_submitted += rc;
+
+            // the rest is submitted on the next loop iteration
+            if (_sq_submitted != _sq_local_tail && !_w_submit.is_active())
+                _w_submit.start();
+
+            return true;
+        }
+
+        if (errno == EINTR)
+            continue;
+
+        if (errno == ETIME)
+            return true;
+
+        if (errno == EBUSY || errno == EAGAIN) {
+            // completion queue is full: free it and try again, callbacks may have queued more entries.
+            // Not from inside reap(): the outer loop would dispatch the same completions again
+            if (!reaped && !_reaping) {
+                reaped = true;
+                reap();
+                to_submit = _sq_local_tail - _sq_submitted;
+                __atomic_store_n(_sq_tail, _sq_local_tail, __ATOMIC_RELEASE);
+                continue;
+            }
+
+            // still busy: retry on the next loop iteration
+            if (!_w_submit.is_active())
+                _w_submit.start();
+
+            return true;
+        }
+
+        log_err("[Uring] io_uring_enter error: {}", strerror(errno));
+        return false;
+    }
+}
+
+void Uring::reap() noexcept
+{
+    if (_reaping)
+        return;
+
+    _reaping = true;
+    unsigned head = *_cq_head;
+
+    while (true) {
+        unsigned tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+        if (head == tail)
+            break;
+
+        for (; head != tail; head++) {
+            auto& cqe = _cqes[head & _cq_mask];
+
+            uint64_t data = cqe.user_data;
+            int res = cqe.res;
+            uint32_t flags = cqe.flags;
+
+            if (!(flags & IORING_CQE_F_MORE) && _inflight)
+                _inflight--;
+
+            // release cqe before callback: callback can submit new operations
+            __atomic_store_n(_cq_head, head + 1, __ATOMIC_RELEASE);
+
+            if (auto* h = reinterpret_cast<UringHandler*>(data & user_data_ptr_mask); h)
+                h->cb_uring(data & user_data_op_mask, data >> user_data_tag_shift, res, flags);
+        }
+    }
+
+    _reaping = false;
+}
+
+void Uring::cb_submit(ev::prepare& w, int revents) noexcept
+{
+    w.stop();
+
+    if (!submit())
+        log_err("[Uring] cannot submit");
+}
+
+void Uring::cb_complete(ev::io& w, int revents) noexcept
+{
+    reap();
+
+    // flush overflowed completions
+    if (__atomic_load_n(_sq_flags, __ATOMIC_RELAXED) & IORING_SQ_CQ_OVERFLOW) {
+        submit();
+        reap();
+    }
+}
+
+#else
+
+Uring::Uring(loop_ptr loop, unsigned entries) : _loop(std::move(loop))
+{
+    log_warn("[Uring] io_uring is not supported");
+}
+
+Uring::~Uring() noexcept = default;
+
+bool Uring::is_ready() const noexcept
+{
+    return false;
+}
+
+bool Uring::prep_accept_multishot(int fd, UringHandler* h, uint8_t op, uint16_t tag) noexcept
+{
+    return false;
+}
+
+bool Uring::prep_recv_multishot(int fd, UringHandler* h, uint8_t op, uint16_t tag) noexcept
+{
+    return false;
+}
+
+bool Uring::prep_sendmsg(int fd, const msghdr* msg, UringHandler* h, uint8_t op, uint16_t tag) noexcept
+{
+    return false;
+}
+
+bool Uring::prep_cancel(UringHandler* h, uint8_t op, uint16_t tag) noexcept
+{
+    return false;
+}
+
+bool Uring::setup_buf_ring(unsigned entries) noexcept
+{
+    return false;
+}
+
+void Uring::add_buf(void* addr, uint32_t len, uint16_t bid) noexcept {}
+
+void Uring::commit_bufs() noexcept {}
+
+bool Uring::has_buffer(uint32_t flags) noexcept
+{
+    return false;
+}
+
+uint16_t Uring::buffer_id(uint32_t flags) noexcept
+{
+    return 0;
+}
+
+bool Uring::has_more(uint32_t flags) noexcept
+{
+    return false;
+}
+
+void Uring::close(milliseconds timeout) noexcept {}
+
+#endif
+
+} // namespace sniper::event
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sniper/event/Loop.h>
+#include <sniper/std/chrono.h>
+#include <sys/socket.h>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace sniper::event {
+
+// Completion receiver. op and tag are the values passed to Uring::prep_*.
+class UringHandler
+{
+public:
+    virtual void cb_uring(uint8_t op, uint16_t tag, int res, uint32_t flags) noexcept = 0;
+
+protected:
+    ~UringHandler() = default;
+};
+
+// io_uring instance driven by libev loop: submissions are batched and flushed once per
+// loop iteration (ev::prepare), completions are dispatched when ring fd is readable.
+class Uring final
+{
+public:
+    Uring(loop_ptr loop, unsigned entries);
+    ~Uring() noexcept;
+
+    [[nodiscard]] bool is_ready() const noexcept;
+
+    // op: 0..7, tag: any 16 bit value. Return false if there is no free sqe.
+    [[nodiscard]] bool prep_accept_multishot(int fd, UringHandler* h, uint8_t op, uint16_t tag) noexcept;
+    [[nodiscard]] bool prep_recv_multishot(int fd, UringHandler* h, uint8_t op, uint16_t tag) noexcept;
+    [[nodiscard]] bool prep_sendmsg(int fd, const msghdr* msg, UringHandler* h, uint8_t op, uint16_t tag) noexcept;
+    // cancel operation, its completion will be with -ECANCELED
+    [[nodiscard]] bool prep_cancel(UringHandler* h, uint8_t op, uint16_t tag) noexcept;
+
+    // One ring of provided buffers per instance, used by prep_recv_multishot
+    [[nodiscard]] bool setup_buf_ring(unsigned entries) noexcept;
+    // buffer is visible to kernel after commit_bufs
+    void add_buf(void* addr, uint32_t len, uint16_t bid) noexcept;
+    void commit_bufs() noexcept;
+
+    [[nodiscard]] static bool has_buffer(uint32_t flags) noexcept;
+    [[nodiscard]] static uint16_t buffer_id(uint32_t flags) noexcept;
+    [[nodiscard]] static bool has_more(uint32_t flags) noexcept;
+
+    // wait for in-flight operations (up to timeout) and close ring
+    void close(milliseconds timeout = 1s) noexcept;
+
+    Uring(const Uring&) = delete;
+    Uring& operator=(const Uring&) = delete;
+
+private:
+    void cb_submit(ev::prepare& w, [[maybe_unused]] int revents) noexcept;
+    void cb_complete(ev::io& w, [[maybe_unused]] int revents) noexcept;
+
+    [[nodiscard]] io_uring_sqe* get_sqe() noexcept;
+    void set_data(io_uring_sqe* sqe, UringHandler* h, uint8_t op, uint16_t tag) noexcept;
+    bool submit(bool wait = false) noexcept;
+    void reap() noexcept;
+
+    loop_ptr _loop;
+    ev::prepare _w_submit;
+    ev::io _w_complete;
+
+    int _fd = -1;
+    size_t _inflight = 0;
+    bool _reaping = false; // callbacks of reap() can submit, submit must not reap again
+
+    // submission queue
+    void* _sq_ptr = nullptr;
+    size_t _sq_size = 0;
+    unsigned* _sq_head = nullptr;
+    unsigned* _sq_tail = nullptr;
+    unsigned* _sq_flags = nullptr;
+    unsigned _sq_mask = 0;
+    unsigned _sq_entries = 0;
+    unsigned _sq_local_tail = 0;
+    unsigned _sq_submitted = 0;
+    io_uring_sqe* _sqes = nullptr;
+    size_t _sqes_size = 0;
+
+    // completion queue
+    void* _cq_ptr = nullptr;
+    size_t _cq_size = 0;
+    unsigned* _cq_head = nullptr;
+    unsigned* _cq_tail = nullptr;
+    unsigned _cq_mask = 0;
+    io_uring_cqe* _cqes = nullptr;
+
+    // provided buffers
+    void* _br_ptr = nullptr;
+    size_t _br_size = 0;
+    unsigned _br_mask = 0;
+    uint16_t _br_tail = 0;
+};
+
+} // namespace sniper::event
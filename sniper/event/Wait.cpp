@@ -25,7 +25,8 @@ namespace sniper::event {
 
 static constexpr seconds clean_interval = 1s;
 
-Wait::Wait(event::loop_ptr loop) : _pool(make_intrusive_noexcept<wait::Pool>(std::move(loop)))
+Wait::Wait(event::loop_ptr loop, milliseconds resolution) :
+    _pool(make_intrusive_noexcept<wait::Pool>(std::move(loop), resolution))
 {
     log_trace(__PRETTY_FUNCTION__);
 
@@ -25,7 +25,8 @@ namespace sniper::event {
 class Wait final
 {
 public:
-    explicit Wait(event::loop_ptr loop);
+    // resolution: precision of group timeouts
+    explicit Wait(event::loop_ptr loop, milliseconds resolution = 1ms);
     virtual ~Wait() noexcept;
 
     void add(intrusive_ptr<wait::Group> wg);
@@ -45,7 +45,7 @@ void Group::set_timeout() noexcept
 
 void Group::detach() noexcept
 {
-    stop();
+    _w_timeout.stop();
     _pool.reset();
 }
 
@@ -58,7 +58,7 @@ void Group::done()
         _count--;
 
     if (!_count) {
-        stop();
+        _w_timeout.stop();
         _pool->done(this);
     }
 }
@@ -68,6 +68,12 @@ void Group::inc(unsigned count) noexcept
     _count += count;
 }
 
+void Group::cb_timeout(event::WheelTimer& w) noexcept
+{
+    if (_pool)
+        _pool->timeout(this);
+}
+
 bool Group::is_empty() const noexcept
 {
     return !_count;
@@ -18,6 +18,7 @@
 
 #include <ev++.h>
 #include <sniper/cache/Cache.h>
+#include <sniper/event/TimerWheel.h>
 #include <sniper/event/wait/Pool.h>
 #include <sniper/std/chrono.h>
 #include <sniper/std/memory.h>
@@ -28,7 +29,7 @@ namespace sniper::event::wait {
 class Group;
 using GroupCache = cache::STDCache<Group>;
 
-class Group : public intrusive_cache_unsafe_ref_counter<Group, GroupCache>, public ev::timer
+class Group : public intrusive_cache_unsafe_ref_counter<Group, GroupCache>
 {
 public:
     Group() = default;
@@ -59,10 +60,12 @@ private:
 
     void set_timeout() noexcept;
     void detach() noexcept;
+    void cb_timeout(event::WheelTimer& w) noexcept;
 
     bool _is_timeout = false;
     milliseconds _timeout = 0ms;
     unsigned _count = 0;
+    event::WheelTimer _w_timeout;
 };
 
 using GroupPtr = intrusive_ptr<Group>;
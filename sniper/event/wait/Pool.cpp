@@ -25,7 +25,7 @@
 
 namespace sniper::event::wait {
 
-Pool::Pool(event::loop_ptr loop) : _loop(std::move(loop))
+Pool::Pool(event::loop_ptr loop, milliseconds resolution) : _loop(std::move(loop)), _wheel(_loop, resolution)
 {
     _w_done.set(*_loop);
     _w_done.set<Pool, &Pool::cb_done>(this);
@@ -54,10 +54,9 @@ void Pool::add(intrusive_ptr<Group>&& wg)
         return;
     }
 
-    wg->set(*_loop);
-    wg->set<Pool, &Pool::cb_timeout>(this);
+    wg->_w_timeout.set<Group, &Group::cb_timeout>(wg.get());
     if (wg->_timeout > 0ms)
-        wg->start((double)wg->_timeout.count() / 1000.0);
+        wg->_w_timeout.start(_wheel, wg->_timeout);
 
     _groups.emplace(wg.get(), std::move(wg));
 }
@@ -77,13 +76,10 @@ void Pool::done(Group* wg)
     }
 }
 
-void Pool::cb_timeout(ev::timer& w, int revents) noexcept
+void Pool::timeout(Group* wg) noexcept
 {
     log_trace(__PRETTY_FUNCTION__);
 
-    w.stop();
-
-    auto* wg = static_cast<wait::Group*>(&w);
     wg->set_timeout();
 
     if (auto it = _groups.find(wg); it != _groups.end()) {
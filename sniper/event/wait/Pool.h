@@ -17,6 +17,8 @@
 #pragma once
 
 #include <sniper/event/Loop.h>
+#include <sniper/event/TimerWheel.h>
+#include <sniper/std/chrono.h>
 #include <sniper/std/functional.h>
 #include <sniper/std/map.h>
 #include <sniper/std/memory.h>
@@ -28,20 +30,21 @@ class Group;
 
 struct Pool final : public intrusive_unsafe_ref_counter<Pool>
 {
-    Pool(event::loop_ptr loop);
+    Pool(event::loop_ptr loop, milliseconds resolution);
     ~Pool();
 
     void add(intrusive_ptr<Group>&& wg);
     void done(Group* wg);
+    void timeout(Group* wg) noexcept;
     void close() noexcept;
 
     function<void(intrusive_ptr<Group>&&)> _cb;
 
 private:
-    void cb_timeout(ev::timer& w, [[maybe_unused]] int revents) noexcept;
     void cb_done(ev::prepare& w, [[maybe_unused]] int revents) noexcept;
 
     event::loop_ptr _loop;
+    event::TimerWheel _wheel;
     ev::prepare _w_done;
 
     unordered_map<Group*, intrusive_ptr<Group>> _groups;
@@ -50,28 +50,7 @@ size_t Buffer::size() const noexcept
 
 BufferState Buffer::read(int fd, uint32_t max_size) noexcept
 {
-    if (!_capacity)
-        return BufferState::Error;
-
-    while (true) {
-        if (_capacity == _size)
-            return BufferState::Full;
-
-        max_size = max_size ? std::min(max_size, _capacity - _size) : _capacity - _size;
-
-        if (auto count = ::read(fd, _data->data() + _size, max_size); count > 0) {
-            _size += count;
-        }
-        else if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
-            return BufferState::Again;
-        }
-        else if (count < 0 && errno == EINTR) {
-            continue;
-        }
-        else {
-            return BufferState::Error;
-        }
-    }
+    return read_with([fd](char* data, size_t size) { return ::read(fd, data, size); }, max_size);
 }
 
 intrusive_ptr<Buffer> make_buffer(size_t size, string_view src) noexcept
@@ -95,6 +74,11 @@ string_view Buffer::tail(size_t processed) const noexcept
     return {};
 }
 
+char* Buffer::data() noexcept
+{
+    return _capacity ? _data->data() : nullptr;
+}
+
 bool Buffer::fill(string_view data) noexcept
 {
     if (!data.empty() && data.size() <= (_capacity - _size)) {
@@ -106,16 +90,43 @@ bool Buffer::fill(string_view data) noexcept
     return false;
 }
 
+size_t Buffer::append(string_view data) noexcept
+{
+    size_t count = std::min(data.size(), (size_t)(_capacity - _size));
+    if (count) {
+        memcpy(_data->data() + _size, data.data(), count);
+        _size += count;
+    }
+
+    return count;
+}
+
+bool Buffer::resize(size_t size) noexcept
+{
+    if (size > _capacity)
+        return false;
+
+    _size = size;
+    return true;
+}
+
 intrusive_ptr<Buffer> renew_buffer(const intrusive_ptr<Buffer>& buf, size_t threshold, uint32_t max_size,
                                    size_t& processed) noexcept
 {
     if (buf->size() >= (buf->capacity() - buf->capacity() / threshold)) {
         // если в буффере осталось места < N%, то выделяем новый и копируем в него хвост
+        auto tail = buf->tail(processed);
+        size_t capacity = buf->capacity();
 
-        if (buf->capacity() * 2 > max_size)
-            return nullptr;
+        // grow only if unprocessed tail takes a large part of buffer
+        if (tail.size() >= capacity / 2) {
+            if (capacity * 2 > max_size)
+                return nullptr;
+
+            capacity *= 2;
+        }
 
-        auto new_buf = make_buffer(buf->capacity() * 2, buf->tail(processed));
+        auto new_buf = make_buffer(capacity, tail);
         processed = 0;
         return new_buf;
     }
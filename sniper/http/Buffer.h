@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <cerrno>
 #include <sniper/cache/ArrayCache.h>
 #include <sniper/cache/Cache.h>
 #include <sniper/std/memory.h>
@@ -44,9 +45,18 @@ struct Buffer final : public intrusive_cache_unsafe_ref_counter<Buffer, BufferCa
     [[nodiscard]] size_t size() const noexcept;
     //    [[nodiscard]] size_t exceed() const noexcept;
     [[nodiscard]] string_view tail(size_t processed) const noexcept;
+    // raw storage of capacity() bytes
+    [[nodiscard]] char* data() noexcept;
 
     [[nodiscard]] BufferState read(int fd, uint32_t max_size = 0) noexcept;
+    // same as read(fd), data comes from reader(char* data, size_t size) with ::read semantics
+    template<typename Reader>
+    [[nodiscard]] BufferState read_with(Reader&& reader, uint32_t max_size = 0) noexcept;
     [[nodiscard]] bool fill(string_view data) noexcept;
+    // copy as much as fits, return number of copied bytes
+    [[nodiscard]] size_t append(string_view data) noexcept;
+    // set size of data, must be <= capacity
+    [[nodiscard]] bool resize(size_t size) noexcept;
 
 private:
     friend intrusive_ptr<Buffer> make_buffer(size_t size, string_view src) noexcept;
@@ -57,6 +67,33 @@ private:
     cache::String::unique _data = cache::String::get_unique_empty();
 };
 
+template<typename Reader>
+BufferState Buffer::read_with(Reader&& reader, uint32_t max_size) noexcept
+{
+    if (!_capacity)
+        return BufferState::Error;
+
+    while (true) {
+        if (_capacity == _size)
+            return BufferState::Full;
+
+        max_size = max_size ? std::min(max_size, _capacity - _size) : _capacity - _size;
+
+        if (auto count = reader(_data->data() + _size, max_size); count > 0) {
+            _size += count;
+        }
+        else if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return BufferState::Again;
+        }
+        else if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        else {
+            return BufferState::Error;
+        }
+    }
+}
+
 [[nodiscard]] intrusive_ptr<Buffer> make_buffer(size_t size, string_view src = {}) noexcept;
 [[nodiscard]] intrusive_ptr<Buffer> renew_buffer(const intrusive_ptr<Buffer>& buf, size_t threshold, uint32_t max_size,
                                                  size_t& processed) noexcept;
@@ -23,7 +23,8 @@
 
 namespace sniper::http {
 
-Client::Client(event::loop_ptr loop, client::Config config) : _loop(std::move(loop)), _config(std::move(config))
+Client::Client(event::loop_ptr loop, client::Config config) :
+    _loop(std::move(loop)), _config(std::move(config)), _wheel(_loop, _config.timer_resolution)
 {
     check(_loop, "[Client] loop is nullptr");
 }
@@ -94,7 +95,7 @@ bool Client::send(const net::Domain& domain, intrusive_ptr<client::Request>&& re
         return false;
 
     try {
-        if (auto [it, rc] = _pools.try_emplace(domain, _loop, _config.pool, domain, domain == _config.proxy, _cb); rc) {
+        if (auto [it, rc] = _pools.try_emplace(domain, _loop, _wheel, _config.pool, domain, domain == _config.proxy, _cb); rc) {
             it->second.send(std::move(req));
             return true;
         }
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <sniper/event/Loop.h>
+#include <sniper/event/TimerWheel.h>
 #include <sniper/http/client/Config.h>
 #include <sniper/http/client/Pool.h>
 #include <sniper/http/client/Request.h>
@@ -49,6 +50,7 @@ private:
 
     event::loop_ptr _loop;
     client::Config _config;
+    event::TimerWheel _wheel;
 
     function<void(intrusive_ptr<client::Request>&&, intrusive_ptr<client::Response>&&)> _cb;
 
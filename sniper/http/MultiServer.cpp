@@ -0,0 +1,222 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <future>
+#include <sniper/log/log.h>
+#include <sniper/threads/Affinity.h>
+#include <thread>
+#include "MultiServer.h"
+
+namespace sniper::http {
+
+namespace {
+
+constexpr double drain_check_interval = 0.01;
+
+} // namespace
+
+struct MultiServer::Worker final
+{
+    void cb_stop(ev::async& w, [[maybe_unused]] int revents) noexcept;
+    void cb_drain(ev::timer& w, [[maybe_unused]] int revents) noexcept;
+
+    unsigned idx = 0;
+    std::atomic_bool running = false; // set by worker after start, cleared before server is destroyed
+    vector<unsigned> cpus;
+    milliseconds drain_timeout = 0ms;
+
+    std::thread t;
+    std::promise<bool> ready;
+
+    event::loop_ptr loop;
+    unique_ptr<Server> server;
+    ev::async w_stop;
+    ev::timer w_drain;
+    steady_clock::time_point drain_deadline;
+};
+
+void MultiServer::Worker::cb_stop(ev::async& w, int revents) noexcept
+{
+    server->stop_accept();
+
+    if (!server->is_busy() || drain_timeout <= 0ms) {
+        loop->break_loop(ev::ALL);
+        return;
+    }
+
+    drain_deadline = steady_clock::now() + drain_timeout;
+    w_drain.start(drain_check_interval, drain_check_interval);
+}
+
+void MultiServer::Worker::cb_drain(ev::timer& w, int revents) noexcept
+{
+    if (server->is_busy() && steady_clock::now() < drain_deadline)
+        return;
+
+    w.stop();
+    loop->break_loop(ev::ALL);
+}
+
+MultiServer::MultiServer(server::MultiConfig config) : _config(std::move(config))
+{
+    if (!_config.threads)
+        _config.threads = std::max(1u, std::thread::hardware_concurrency());
+}
+
+MultiServer::~MultiServer() noexcept
+{
+    stop();
+}
+
+void MultiServer::bind(uint16_t port)
+{
+    bind("", port);
+}
+
+void MultiServer::bind(const string& ip, uint16_t port)
+{
+    _addrs.emplace_back(ip, port);
+}
+
+size_t MultiServer::size() const noexcept
+{
+    return _workers.size();
+}
+
+const server::Stats* MultiServer::stats(unsigned idx) const noexcept
+{
+    for (auto& w : _workers)
+        if (w->idx == idx && w->running.load(std::memory_order_acquire))
+            return &w->server->stats();
+
+    return nullptr;
+}
+
+bool MultiServer::start()
+{
+    if (!_workers.empty() || _addrs.empty() || !_cb)
+        return false;
+
+    vector<tuple<Worker*, std::future<bool>>> ready;
+    ready.reserve(_config.threads);
+
+    for (unsigned i = 0; i < _config.threads; i++) {
+        auto& w = _workers.emplace_back(make_unique<Worker>());
+        w->idx = i;
+        w->drain_timeout = _config.drain_timeout;
+
+        if (!_config.cpus.empty()) {
+            w->cpus.emplace_back(_config.cpus[i % _config.cpus.size()]);
+        }
+        else if (!_config.numa_nodes.empty()) {
+            w->cpus = threads::numa_node_cpus(_config.numa_nodes[i % _config.numa_nodes.size()]);
+            if (w->cpus.empty())
+                log_warn("[MultiServer] cannot get cpus of numa node {}", _config.numa_nodes[i % _config.numa_nodes.size()]);
+        }
+
+        ready.emplace_back(w.get(), w->ready.get_future());
+        w->t = std::thread([this, ptr = w.get()] { run(*ptr); });
+    }
+
+    bool ok = true;
+    for (auto& [w, f] : ready)
+        ok = f.get() && ok;
+
+    if (!ok)
+        stop();
+
+    return ok;
+}
+
+void MultiServer::stop() noexcept
+{
+    for (auto& w : _workers)
+        if (w->running)
+            w->w_stop.send();
+
+    // workers destroy their servers, loops are destroyed after join
+    join();
+    _workers.clear();
+}
+
+void MultiServer::join() noexcept
+{
+    for (auto& w : _workers)
+        if (w->t.joinable())
+            w->t.join();
+}
+
+void MultiServer::run(Worker& w) noexcept
+{
+    bool ready = false;
+
+    try {
+        if (!w.cpus.empty() && !threads::set_affinity(w.cpus))
+            log_warn("[MultiServer] cannot set affinity for worker {}", w.idx);
+
+        // loop and all caches are allocated after pinning: memory is local for the worker cpu
+        w.loop = event::make_loop();
+        w.server = make_unique<Server>(w.loop, _config.server);
+        w.server->set_cb(_cb);
+        if (_stream_cb)
+            w.server->set_stream_cb(_stream_cb);
+
+        for (auto& [ip, port] : _addrs) {
+            if (!w.server->bind(ip, port)) {
+                log_err("[MultiServer] worker {} cannot bind {}:{}", w.idx, ip, port);
+                throw std::runtime_error("bind error");
+            }
+        }
+
+        if (_init_cb)
+            _init_cb(w.idx, w.loop);
+
+        w.w_stop.set(*w.loop);
+        w.w_stop.set<Worker, &Worker::cb_stop>(&w);
+        w.w_drain.set(*w.loop);
+        w.w_drain.set<Worker, &Worker::cb_drain>(&w);
+        w.w_stop.start();
+
+        ready = true;
+        w.running.store(true, std::memory_order_release);
+        w.ready.set_value(true);
+
+        w.loop->run();
+    }
+    catch (std::exception& e) {
+        log_err("[MultiServer] worker {}: {}", w.idx, e.what());
+    }
+    catch (...) {
+        log_err("[MultiServer] worker {}: unknown exception", w.idx);
+    }
+
+    if (!ready)
+        w.ready.set_value(false);
+
+    w.running.store(false, std::memory_order_release);
+
+    // destroy in the worker thread: caches are thread local.
+    // Loop is destroyed by MultiServer after join: stop() can send w_stop to it at any moment
+    w.w_drain.stop();
+    w.w_stop.stop();
+    w.server.reset();
+}
+
+} // namespace sniper::http
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sniper/http/Server.h>
+#include <sniper/http/server/MultiConfig.h>
+#include <sniper/std/functional.h>
+#include <sniper/std/list.h>
+#include <sniper/std/tuple.h>
+
+namespace sniper::http {
+
+// N worker threads, each one with own loop, server::Pool and SO_REUSEPORT listeners.
+// Callbacks are copied to every worker and called from worker threads.
+class MultiServer final
+{
+public:
+    explicit MultiServer(server::MultiConfig config);
+    ~MultiServer() noexcept;
+
+    template<typename T>
+    void set_cb(T&& cb);
+
+    // see Server::set_stream_cb
+    template<typename T>
+    void set_stream_cb(T&& cb);
+
+    // called in every worker thread before accepting: (worker index, worker loop)
+    template<typename T>
+    void set_init_cb(T&& cb);
+
+    // listeners are created by start(), one per worker
+    void bind(uint16_t port);
+    void bind(const string& ip, uint16_t port);
+
+    [[nodiscard]] bool start();
+
+    // stop accept, wait for in-flight requests (up to drain_timeout) and join workers
+    void stop() noexcept;
+
+    [[nodiscard]] size_t size() const noexcept;
+
+    // counters of worker idx, nullptr if it is not running.
+    // Pointer is valid only until stop() or until the worker loop exits
+    [[nodiscard]] const server::Stats* stats(unsigned idx) const noexcept;
+
+private:
+    struct Worker;
+
+    void run(Worker& w) noexcept;
+    void join() noexcept;
+
+    server::MultiConfig _config;
+    list<tuple<string, uint16_t>> _addrs;
+    list<unique_ptr<Worker>> _workers;
+
+    function<void(const intrusive_ptr<server::Connection>&, const intrusive_ptr<server::Request>&,
+                  const intrusive_ptr<server::Response>&)>
+        _cb;
+    function<void(const intrusive_ptr<server::Connection>&, const intrusive_ptr<server::Request>&,
+                  const intrusive_ptr<server::Response>&)>
+        _stream_cb;
+    function<void(unsigned, const event::loop_ptr&)> _init_cb;
+};
+
+template<typename T>
+void MultiServer::set_cb(T&& cb)
+{
+    _cb = std::forward<T>(cb);
+}
+
+template<typename T>
+void MultiServer::set_stream_cb(T&& cb)
+{
+    _stream_cb = std::forward<T>(cb);
+}
+
+template<typename T>
+void MultiServer::set_init_cb(T&& cb)
+{
+    _init_cb = std::forward<T>(cb);
+}
+
+} // namespace sniper::http
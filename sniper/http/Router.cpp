@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sniper/std/check.h>
+#include <sniper/std/tuple.h>
+#include <sniper/std/vector.h>
+#include <sniper/strings/ascii_case.h>
+#include "Router.h"
+
+namespace sniper::http {
+
+struct Router::Node final
+{
+    string prefix;
+    string indices; // first bytes of static children
+    vector<unique_ptr<Node>> children;
+
+    unique_ptr<Node> param;    // ":name"
+    unique_ptr<Node> wildcard; // "*name"
+    string name;               // for param and wildcard nodes
+
+    small_vector<tuple<string, Handler>, 2> handlers;
+
+    [[nodiscard]] const Handler* handler(string_view method) const noexcept;
+    void not_allowed(bool& path_found, Methods* allow) const noexcept;
+    [[nodiscard]] Node* insert_static(string_view s);
+    [[nodiscard]] static Node* insert_capture(unique_ptr<Node>& slot, string_view name, string_view path);
+    [[nodiscard]] const Handler* find(string_view method, string_view path, Params& params, bool& path_found,
+                                      Methods* allow) const noexcept;
+};
+
+namespace {
+
+size_t common_prefix(string_view a, string_view b) noexcept
+{
+    size_t i = 0;
+    for (size_t max = std::min(a.size(), b.size()); i < max && a[i] == b[i]; i++) {}
+
+    return i;
+}
+
+bool same_method(string_view a, string_view b) noexcept
+{
+    return a.size() == b.size() && strings::iequals(a, b);
+}
+
+} // namespace
+
+const Router::Handler* Router::Node::handler(string_view method) const noexcept
+{
+    for (auto& [m, h] : handlers)
+        if (m == "*" || same_method(m, method))
+            return &h;
+
+    return nullptr;
+}
+
+// path matches but method does not: collect methods of this node for Allow
+void Router::Node::not_allowed(bool& path_found, Methods* allow) const noexcept
+{
+    path_found = path_found || !handlers.empty();
+    if (!allow)
+        return;
+
+    for (auto& [m, h] : handlers) {
+        bool found = false;
+        for (auto a : *allow)
+            found = found || same_method(a, m);
+
+        // inline capacity only: no allocation
+        if (!found && allow->size() < allow->capacity())
+            allow->emplace_back(m);
+    }
+}
+
+Router::Node* Router::Node::insert_static(string_view s)
+{
+    Node* n = this;
+
+    while (!s.empty()) {
+        auto i = n->indices.find(s[0]);
+        if (i == string::npos) {
+            n->indices.push_back(s[0]);
+            auto& child = n->children.emplace_back(make_unique<Node>());
+            child->prefix = s;
+            return child.get();
+        }
+
+        auto& child = n->children[i];
+        size_t common = common_prefix(child->prefix, s);
+
+        // split: child keeps its subtree under the rest of prefix
+        if (common < child->prefix.size()) {
+            auto mid = make_unique<Node>();
+            mid->prefix = child->prefix.substr(0, common);
+            child->prefix.erase(0, common);
+            mid->indices.push_back(child->prefix[0]);
+            mid->children.emplace_back(std::move(child));
+            child = std::move(mid);
+        }
+
+        n = child.get();
+        s.remove_prefix(common);
+    }
+
+    return n;
+}
+
+Router::Node* Router::Node::insert_capture(unique_ptr<Node>& slot, string_view name, string_view path)
+{
+    check(!name.empty() && name.find('/') == string_view::npos, "[Router] bad parameter name in {}", path);
+
+    if (!slot) {
+        slot = make_unique<Node>();
+        slot->name = name;
+    }
+
+    check(slot->name == name, "[Router] parameter {} conflicts with {} in {}", name, slot->name, path);
+    return slot.get();
+}
+
+// path - rest after prefix of this node
+const Router::Handler* Router::Node::find(string_view method, string_view path, Params& params, bool& path_found,
+                                          Methods* allow) const noexcept
+{
+    if (path.empty()) {
+        if (auto* h = handler(method); h)
+            return h;
+
+        not_allowed(path_found, allow);
+    }
+    else if (auto i = indices.find(path[0]); i != string::npos) {
+        auto& child = *children[i];
+        if (path.substr(0, child.prefix.size()) == child.prefix)
+            if (auto* h = child.find(method, path.substr(child.prefix.size()), params, path_found, allow); h)
+                return h;
+    }
+
+    // empty segment is not a parameter, params are not grown: no allocation
+    if (param && !path.empty() && path[0] != '/' && params.size() < params.capacity()) {
+        auto segment = path.substr(0, path.find('/'));
+
+        params.emplace_back(param->name, segment);
+        if (auto* h = param->find(method, path.substr(segment.size()), params, path_found, allow); h)
+            return h;
+
+        params.pop_back();
+    }
+
+    if (wildcard) {
+        if (auto* h = wildcard->handler(method); h && params.size() < params.capacity()) {
+            params.emplace_back(wildcard->name, path);
+            return h;
+        }
+
+        wildcard->not_allowed(path_found, allow);
+    }
+
+    return nullptr;
+}
+
+Router::Router() : _root(make_unique<Node>()) {}
+
+Router::~Router() noexcept = default;
+
+void Router::add(string_view method, string_view path, Handler handler)
+{
+    check(!method.empty(), "[Router] empty method");
+    check(!path.empty() && path[0] == '/', "[Router] path must start with '/': {}", path);
+    check(handler, "[Router] handler is empty");
+
+    Node* n = _root.get();
+
+    for (string_view rest = path; !rest.empty();) {
+        auto pos = rest.find_first_of(":*");
+        n = n->insert_static(rest.substr(0, pos));
+
+        if (pos == string_view::npos)
+            break;
+
+        rest.remove_prefix(pos);
+        if (rest[0] == ':') {
+            auto name = rest.substr(1, rest.find('/') - 1);
+            n = Node::insert_capture(n->param, name, path);
+            rest.remove_prefix(name.size() + 1);
+        }
+        else {
+            n = Node::insert_capture(n->wildcard, rest.substr(1), path);
+            break;
+        }
+    }
+
+    for (auto& [m, h] : n->handlers)
+        check(!same_method(m, method), "[Router] duplicate route {} {}", method, path);
+
+    // any method is checked last
+    if (method == "*")
+        n->handlers.emplace_back(method, std::move(handler));
+    else
+        n->handlers.insert(n->handlers.begin(), {string(method), std::move(handler)});
+}
+
+void Router::set_not_found(Handler handler)
+{
+    _not_found = std::move(handler);
+}
+
+const Router::Handler* Router::match(string_view method, string_view path, Params& params,
+                                     bool* path_found) const noexcept
+{
+    bool found = false;
+    auto* h = _root->find(method, path, params, found, nullptr);
+
+    if (path_found)
+        *path_found = found;
+
+    return h;
+}
+
+void Router::operator()(const intrusive_ptr<server::Connection>& conn, const intrusive_ptr<server::Request>& req,
+                        const intrusive_ptr<server::Response>& resp) const
+{
+    Params params;
+    Methods allow;
+    bool path_found = false;
+
+    if (auto* h = _root->find(req->method(), req->path(), params, path_found, &allow); h) {
+        (*h)(conn, req, resp, params);
+        return;
+    }
+
+    if (_not_found) {
+        _not_found(conn, req, resp, params);
+        return;
+    }
+
+    if (!path_found) {
+        resp->code = ResponseStatus::NOT_FOUND;
+        conn->send(resp);
+        return;
+    }
+
+    string header = "Allow: ";
+    for (size_t i = 0; i < allow.size(); i++) {
+        if (i)
+            header += ", ";
+        header += allow[i];
+    }
+    header += "\r\n";
+
+    resp->code = ResponseStatus::METHOD_NOT_ALLOWED;
+    resp->add_header_copy(header);
+    conn->send(resp);
+}
+
+} // namespace sniper::http
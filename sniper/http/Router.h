@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sniper/http/Server.h>
+#include <sniper/std/boost_vector.h>
+#include <sniper/std/functional.h>
+#include <sniper/std/memory.h>
+#include <sniper/std/string.h>
+
+namespace sniper::http {
+
+// Radix tree over request path with per-method handlers:
+//   router.add("GET", "/user/:id", handler);      // one segment, up to next '/'
+//   router.add("GET", "/static/*file", handler);  // rest of path, only at the end
+//   router.add("*", "/health", handler);          // any method
+//   server.set_cb([&router](auto& conn, auto& req, auto& resp) { router(conn, req, resp); });
+// Static segments have priority over parameters, parameters over wildcards. Methods are compared
+// case-insensitively: routes match also with Config::normalize.
+// Parameter values are views into request buffer, names - into router.
+class Router final
+{
+public:
+    using Params = small_vector<pair_sv, 8>;
+    using Handler = function<void(const intrusive_ptr<server::Connection>&, const intrusive_ptr<server::Request>&,
+                                  const intrusive_ptr<server::Response>&, const Params&)>;
+
+    Router();
+    ~Router() noexcept;
+
+    void add(string_view method, string_view path, Handler handler);
+
+    // called for not matched requests, by default 404 (405 with Allow if only method is not matched) is sent
+    void set_not_found(Handler handler);
+
+    void operator()(const intrusive_ptr<server::Connection>& conn, const intrusive_ptr<server::Request>& req,
+                    const intrusive_ptr<server::Response>& resp) const;
+
+    // nullptr if not found, path_found - path matches some route with other method.
+    // Routes with more parameters than params capacity are not matched
+    [[nodiscard]] const Handler* match(string_view method, string_view path, Params& params,
+                                       bool* path_found = nullptr) const noexcept;
+
+private:
+    struct Node;
+    using Methods = small_vector<string_view, 8>;
+
+    unique_ptr<Node> _root;
+    Handler _not_found;
+};
+
+} // namespace sniper::http
@@ -18,8 +18,13 @@
 #include <sniper/log/log.h>
 #include <sniper/net/socket.h>
 #include <sniper/std/check.h>
+#include <sys/socket.h>
 #include "Server.h"
+#include "server/Http2.h"
+#include "server/Inbox.h"
 #include "server/ServerInt.h"
+#include "server/Tls.h"
+#include "server/Uring.h"
 
 namespace sniper::http {
 
@@ -65,19 +70,70 @@ Server::Server(event::loop_ptr loop, intrusive_ptr<server::Config> config) :
     _w_date.set<Server, &Server::cb_date>(this);
     _w_date.start(1.0, 1.0);
     _pool->date = gen_date();
+    _pool->inbox = make_shared<server::Inbox>(_loop, _pool.get());
+    _pool->wheel = make_unique<event::TimerWheel>(_loop, _config->timer_resolution);
+
+    if (_config->overload_lag > 0ms || _config->overload_accept_lag > 0ms) {
+        check(_config->overload_interval > 0ms, "[Server] overload_interval must be positive");
+        _w_overload.set(*_loop);
+        _w_overload.set<Server, &Server::cb_overload>(this);
+        _overload_deadline = _loop->now() + (double)_config->overload_interval.count() / 1000.0;
+        _w_overload.start((double)_config->overload_interval.count() / 1000.0, 0);
+    }
+
+    if (_config->io_uring) {
+        _pool->uring = make_unique<server::Uring>(_loop, *_config);
+        if (!_pool->uring->is_ready()) {
+            log_warn("[Server] io_uring is not available, use libev");
+            _pool->uring.reset();
+        }
+    }
+
+    if (_config->http2 && !server::http2_supported())
+        log_warn("[Server] library is built without HTTP/2 support, use HTTP/1.x");
+
+    if (!_config->tls_cert.empty()) {
+        _pool->tls = make_unique<server::Tls>(*_config);
+        check(_pool->tls->is_ready(), "[Server] cannot init TLS");
+    }
 }
 
 Server::~Server() noexcept
 {
     _w_date.stop();
+    _w_overload.stop();
+    _pool->inbox->close();
+    stop_accept();
+    _pool->close();
+}
 
-    for (auto& w : _w_accept)
-        if (w->is_active()) {
-            w->stop();
-            ::close(w->fd);
+void Server::stop_accept() noexcept
+{
+    // paused watchers are stopped but keep listener
+    for (auto& w : _w_accept) {
+        w->stop();
+        ::close(w->fd);
+    }
+
+    _w_accept.clear();
+
+    // wakes up multishot accept
+    for (auto& [fd, armed] : _uring_accept)
+        if (fd >= 0) {
+            ::shutdown(fd, SHUT_RDWR);
+            ::close(fd);
+            fd = -1;
         }
+}
 
-    _pool->close();
+bool Server::is_busy() const noexcept
+{
+    return _pool->is_busy();
+}
+
+const server::Stats& Server::stats() const noexcept
+{
+    return _pool->stats;
 }
 
 bool Server::bind(uint16_t port) noexcept
@@ -91,11 +147,40 @@ bool Server::bind(const string& ip, uint16_t port) noexcept
     if (fd < 0)
         return false;
 
+    if (_pool->uring) {
+        try {
+            _uring_accept.emplace_back(fd, false);
+        }
+        catch (...) {
+            // OOM guard
+            perror("[OOM][Server] cannot bind");
+            ::close(fd);
+            return false;
+        }
+
+        if (_accept_paused)
+            return true;
+
+        if (_pool->uring->ring.prep_accept_multishot(fd, this, 0, _uring_accept.size() - 1)) {
+            std::get<1>(_uring_accept.back()) = true;
+            return true;
+        }
+
+        std::get<0>(_uring_accept.back()) = -1;
+    }
+
+    return start_accept_watcher(fd);
+}
+
+bool Server::start_accept_watcher(int fd) noexcept
+{
     try {
         auto w = make_unique<ev::io>();
         w->set(*_loop);
         w->set<Server, &Server::cb_accept>(this);
-        w->start(fd, ev::READ);
+        w->set(fd, ev::READ);
+        if (!_accept_paused)
+            w->start();
         _w_accept.emplace_back(std::move(w));
     }
     catch (...) {
@@ -110,17 +195,11 @@ bool Server::bind(const string& ip, uint16_t port) noexcept
 
 void Server::cb_accept(ev::io& w, int revents) noexcept
 {
-    while (true) {
+    // fairness: listener stays readable, the rest of backlog is accepted on the next loop iteration
+    for (uint32_t count = 0; !_config->accept_budget || count < _config->accept_budget; count++) {
         if (auto [fd, peer] = net::socket::tcp::accept4(w.fd); fd >= 0) {
-            net::socket::tcp::set_defer_accept(fd);
-            net::socket::tcp::set_fastopen(fd);
-
-            if (auto conn = _pool->get(_loop, _pool); conn) {
-                conn->set(peer, fd);
-                continue;
-            }
-
-            ::close(fd);
+            accept_conn(fd, peer);
+            continue;
         }
         else if (fd < 0 && errno == EINTR) {
             continue;
@@ -135,9 +214,120 @@ void Server::cb_accept(ev::io& w, int revents) noexcept
     }
 }
 
+void Server::accept_conn(int fd, net::Peer peer) noexcept
+{
+    net::socket::tcp::set_defer_accept(fd);
+    net::socket::tcp::set_fastopen(fd);
+
+    if (auto conn = _pool->get(_loop, _pool); conn) {
+        conn->set(peer, fd);
+        return;
+    }
+
+    ::close(fd);
+}
+
+void Server::cb_uring(uint8_t op, uint16_t tag, int res, uint32_t flags) noexcept
+{
+    int listen_fd = tag < _uring_accept.size() ? std::get<0>(_uring_accept[tag]) : -1;
+
+    if (listen_fd >= 0 && !event::Uring::has_more(flags))
+        std::get<1>(_uring_accept[tag]) = false;
+
+    if (res >= 0) {
+        if (listen_fd < 0) {
+            ::close(res);
+            return;
+        }
+
+        // any family fits, Peer keeps only IPv4
+        sockaddr_storage addr{};
+        socklen_t addr_len = sizeof(addr);
+        if (getpeername(res, (sockaddr*)&addr, &addr_len) == 0)
+            accept_conn(res, addr.ss_family == AF_INET ? net::Peer(*(const sockaddr_in*)&addr) : net::Peer());
+        else
+            ::close(res);
+    }
+    else if (listen_fd >= 0 && (res == -EINVAL || res == -EOPNOTSUPP)) {
+        // kernel without multishot accept
+        log_warn("[Server] multishot accept is not supported, use libev");
+        std::get<0>(_uring_accept[tag]) = -1;
+        if (!start_accept_watcher(listen_fd))
+            ::close(listen_fd);
+        return;
+    }
+    else if (listen_fd >= 0 && res != -EINTR && res != -ECONNABORTED && res != -ECANCELED) {
+        log_err("[Server:accept] cannot accept, error={}", strerror(-res));
+    }
+
+    // cancelled by pause_accept: rearmed on resume
+    if (listen_fd >= 0 && !std::get<1>(_uring_accept[tag]) && !_accept_paused)
+        start_uring_accept(tag);
+}
+
+void Server::start_uring_accept(uint16_t tag) noexcept
+{
+    auto& [fd, armed] = _uring_accept[tag];
+
+    if (_pool->uring->ring.prep_accept_multishot(fd, this, 0, tag)) {
+        armed = true;
+        return;
+    }
+
+    int listen_fd = fd;
+    fd = -1;
+    if (!start_accept_watcher(listen_fd))
+        ::close(listen_fd);
+}
+
+// listeners are kept: new connections wait in backlog
+void Server::pause_accept(bool pause) noexcept
+{
+    if (pause == _accept_paused)
+        return;
+
+    _accept_paused = pause;
+    if (pause)
+        _pool->stats.accept_pauses.fetch_add(1, std::memory_order_relaxed);
+
+    for (auto& w : _w_accept) {
+        if (pause)
+            w->stop();
+        else
+            w->start();
+    }
+
+    for (uint16_t tag = 0; tag < _uring_accept.size(); tag++) {
+        auto [fd, armed] = _uring_accept[tag];
+        if (fd < 0)
+            continue;
+
+        if (pause && armed && !_pool->uring->ring.prep_cancel(this, 0, tag))
+            log_warn("[Server] cannot pause io_uring accept");
+        else if (!pause && !armed)
+            start_uring_accept(tag);
+    }
+}
+
 void Server::cb_date(ev::timer& w, int revents) noexcept
 {
     _pool->date = gen_date();
 }
 
+// timer is late by the time loop spends in callbacks after its deadline
+void Server::cb_overload(ev::timer& w, int revents) noexcept
+{
+    double interval = (double)_config->overload_interval.count() / 1000.0;
+    double lag = std::max(ev_time() - _overload_deadline, 0.0);
+
+    _pool->loop_lag = duration_cast<steady_clock::duration>(std::chrono::duration<double>(lag));
+    _pool->stats.loop_lag_us.store(uint64_t(lag * 1e6), std::memory_order_relaxed);
+
+    if (_config->overload_accept_lag > 0ms)
+        pause_accept(_pool->loop_lag > _config->overload_accept_lag);
+
+    _overload_deadline = _loop->now() + interval;
+    w.start(interval, 0);
+}
+
 } // namespace sniper::http
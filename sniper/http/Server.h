@@ -17,17 +17,22 @@
 #pragma once
 
 #include <sniper/event/Loop.h>
+#include <sniper/event/Uring.h>
 #include <sniper/http/Buffer.h>
 #include <sniper/http/server/Config.h>
 #include <sniper/http/server/Connection.h>
+#include <sniper/http/server/Handle.h>
 #include <sniper/http/server/Pool.h>
 #include <sniper/http/server/Request.h>
 #include <sniper/http/server/Response.h>
+#include <sniper/http/server/Stats.h>
 #include <sniper/std/list.h>
+#include <sniper/std/tuple.h>
+#include <sniper/std/vector.h>
 
 namespace sniper::http {
 
-class Server final
+class Server final : public event::UringHandler
 {
 public:
     explicit Server(event::loop_ptr loop);
@@ -38,17 +43,41 @@ public:
     template<typename T>
     void set_cb(T&& cb);
 
+    // Called when headers of request with body are parsed, before the body is received.
+    // Request::set_body_cb inside it switches the request to streaming mode: body is passed by slices,
+    // response is sent as usual and the request is not passed to the main callback.
+    template<typename T>
+    void set_stream_cb(T&& cb);
+
     [[nodiscard]] bool bind(uint16_t port) noexcept;
     [[nodiscard]] bool bind(const string& ip, uint16_t port) noexcept;
 
+    // close listeners, already accepted connections keep working
+    void stop_accept() noexcept;
+    // some connection has requests in user callback or responses not yet written
+    [[nodiscard]] bool is_busy() const noexcept;
+
+    [[nodiscard]] const server::Stats& stats() const noexcept;
+
 private:
     void cb_accept(ev::io& w, [[maybe_unused]] int revents) noexcept;
     void cb_date(ev::timer& w, [[maybe_unused]] int revents) noexcept;
+    void cb_overload(ev::timer& w, [[maybe_unused]] int revents) noexcept;
+    void cb_uring(uint8_t op, uint16_t tag, int res, uint32_t flags) noexcept final;
+
+    [[nodiscard]] bool start_accept_watcher(int fd) noexcept;
+    void start_uring_accept(uint16_t tag) noexcept;
+    void pause_accept(bool pause) noexcept;
+    void accept_conn(int fd, net::Peer peer) noexcept;
 
     event::loop_ptr _loop;
     ev::timer _w_date;
+    ev::timer _w_overload;
+    ev::tstamp _overload_deadline = 0;
+    bool _accept_paused = false;
     intrusive_ptr<server::Config> _config;
     list<unique_ptr<ev::io>> _w_accept;
+    vector<tuple<int, bool>> _uring_accept; // listeners with multishot accept (-1 if closed) and its state
     intrusive_ptr<server::Pool> _pool;
 };
 
@@ -58,4 +87,10 @@ void Server::set_cb(T&& cb)
     _pool->_cb = std::forward<T>(cb);
 }
 
+template<typename T>
+void Server::set_stream_cb(T&& cb)
+{
+    _pool->_stream_cb = std::forward<T>(cb);
+}
+
 } // namespace sniper::http
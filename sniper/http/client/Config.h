@@ -52,6 +52,8 @@ struct Config final
 {
     net::Domain proxy;
     size_t max_pools = 1000;
+    // connect and response timeouts are kept in a timer wheel with this precision
+    milliseconds timer_resolution = 10ms;
 
     PoolConfig pool;
 };
@@ -28,10 +28,10 @@
 
 namespace sniper::http::client {
 
-Connection::Connection(event::loop_ptr loop, ConnectionConfig config, net::Peer peer, bool is_proxy,
-                       const function<void(intrusive_ptr<Request>&&, intrusive_ptr<Response>&&)>& cb) :
+Connection::Connection(event::loop_ptr loop, event::TimerWheel& wheel, ConnectionConfig config, net::Peer peer,
+                       bool is_proxy, const function<void(intrusive_ptr<Request>&&, intrusive_ptr<Response>&&)>& cb) :
     _loop(std::move(loop)),
-    _config(config), _peer(peer), _is_proxy(is_proxy), _cb(cb)
+    _wheel(wheel), _config(config), _peer(peer), _is_proxy(is_proxy), _cb(cb)
 {
     log_trace("Conn={:p}, {}", reinterpret_cast<const void*>(this), __PRETTY_FUNCTION__);
 
@@ -39,8 +39,6 @@ Connection::Connection(event::loop_ptr loop, ConnectionConfig config, net::Peer
 
     _w_read.set(*_loop);
     _w_write.set(*_loop);
-    _w_response_timeout.set(*_loop);
-    _w_connect_timeout.set(*_loop);
     _w_prepare.set(*_loop);
 
     _w_read.set<Connection, &Connection::cb_read>(this);
@@ -80,7 +78,7 @@ bool Connection::send(intrusive_ptr<Request>&& req)
         _in.emplace_back(std::move(req), std::move(resp));
 
         if (_config.response_timeout > 0ms && !_w_response_timeout.is_active())
-            _w_response_timeout.again();
+            _w_response_timeout.start(_wheel, _config.response_timeout, true);
 
         //        if (!_w_write.is_active() && write_int())
         //            _w_write.start();
@@ -123,11 +121,8 @@ void Connection::connect()
         return;
     }
 
-    if (_config.response_timeout > 0ms) {
-        double to_d = (double)duration_cast<milliseconds>(_config.response_timeout).count() / 1000.0;
-        _w_response_timeout.set(to_d, to_d);
-        _w_connect_timeout.start(to_d, 0);
-    }
+    if (_config.response_timeout > 0ms)
+        _w_connect_timeout.start(_wheel, _config.response_timeout);
 
     _w_read.start(fd, ev::READ);
 
@@ -172,14 +167,14 @@ void Connection::close(bool run_cb_disconnect, string_view reason) noexcept
     }
 }
 
-void Connection::cb_response_timeout(ev::timer& w, int revents) noexcept
+void Connection::cb_response_timeout(event::WheelTimer& w) noexcept
 {
     log_trace("Conn={:p}, {}", reinterpret_cast<const void*>(this), __PRETTY_FUNCTION__);
 
     close(true, "response timeout");
 }
 
-void Connection::cb_connect_timeout(ev::timer& w, int revents) noexcept
+void Connection::cb_connect_timeout(event::WheelTimer& w) noexcept
 {
     log_trace("Conn={:p}, {}", reinterpret_cast<const void*>(this), __PRETTY_FUNCTION__);
 
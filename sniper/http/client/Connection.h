@@ -17,6 +17,7 @@
 #pragma once
 
 #include <sniper/event/Loop.h>
+#include <sniper/event/TimerWheel.h>
 #include <sniper/http/client/Config.h>
 #include <sniper/net/Peer.h>
 #include <sniper/std/deque.h>
@@ -41,7 +42,7 @@ class Response;
 class Connection
 {
 public:
-    Connection(event::loop_ptr loop, ConnectionConfig config, net::Peer peer, bool is_proxy,
+    Connection(event::loop_ptr loop, event::TimerWheel& wheel, ConnectionConfig config, net::Peer peer, bool is_proxy,
                const function<void(intrusive_ptr<Request>&&, intrusive_ptr<Response>&&)>& cb);
     ~Connection() noexcept;
 
@@ -57,14 +58,15 @@ private:
     void cb_prepare(ev::prepare& w, [[maybe_unused]] int revents);
     void cb_read(ev::io& w, [[maybe_unused]] int revents) noexcept;
     void cb_write(ev::io& w, [[maybe_unused]] int revents) noexcept;
-    void cb_response_timeout(ev::timer& w, [[maybe_unused]] int revents) noexcept;
-    void cb_connect_timeout(ev::timer& w, [[maybe_unused]] int revents) noexcept;
+    void cb_response_timeout(event::WheelTimer& w) noexcept;
+    void cb_connect_timeout(event::WheelTimer& w) noexcept;
     void close(bool run_cb_disconnect, string_view reason) noexcept;
     [[nodiscard]] bool write_int() noexcept;
     [[nodiscard]] RecvStatus read_int(int fd) noexcept;
     [[nodiscard]] RecvStatus read_int_empty(int fd) const noexcept;
 
     event::loop_ptr _loop;
+    event::TimerWheel& _wheel;
     ConnectionConfig _config;
     net::Peer _peer;
     bool _is_proxy;
@@ -72,8 +74,8 @@ private:
     ev::io _w_read;
     ev::io _w_write;
     ev::prepare _w_prepare;
-    ev::timer _w_response_timeout;
-    ev::timer _w_connect_timeout;
+    event::WheelTimer _w_response_timeout;
+    event::WheelTimer _w_connect_timeout;
 
     const function<void(intrusive_ptr<Request>&&, intrusive_ptr<Response>&&)>& _cb;
     ConnectionStatus _status = ConnectionStatus::Closed;
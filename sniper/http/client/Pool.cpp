@@ -30,10 +30,10 @@
 
 namespace sniper::http::client {
 
-Pool::Pool(event::loop_ptr loop, PoolConfig config, const net::Domain& domain, bool is_proxy,
+Pool::Pool(event::loop_ptr loop, event::TimerWheel& wheel, PoolConfig config, const net::Domain& domain, bool is_proxy,
            const function<void(intrusive_ptr<Request>&&, intrusive_ptr<Response>&&)>& cb) :
     _loop(std::move(loop)),
-    _config(config), _domain(domain), _is_proxy(is_proxy), _cb(cb)
+    _wheel(wheel), _config(config), _domain(domain), _is_proxy(is_proxy), _cb(cb)
 {
     log_trace(__PRETTY_FUNCTION__);
 
@@ -48,7 +48,7 @@ Pool::Pool(event::loop_ptr loop, PoolConfig config, const net::Domain& domain, b
 
     for (auto& node : _domain.nodes) {
         for (size_t i = 0; i < _config.conns_per_ip && _connecting.size() < _config.max_conns; i++) {
-            _connecting.emplace_back(_loop, _config.connection, node, _is_proxy, _cb);
+            _connecting.emplace_back(_loop, _wheel, _config.connection, node, _is_proxy, _cb);
             _connecting.back().connect();
         }
 
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <sniper/event/Loop.h>
+#include <sniper/event/TimerWheel.h>
 #include <sniper/http/client/Config.h>
 #include <sniper/http/client/Connection.h>
 #include <sniper/std/functional.h>
@@ -31,7 +32,7 @@ class Request;
 class Pool final
 {
 public:
-    Pool(event::loop_ptr loop, PoolConfig config, const net::Domain& domain, bool is_proxy,
+    Pool(event::loop_ptr loop, event::TimerWheel& wheel, PoolConfig config, const net::Domain& domain, bool is_proxy,
          const function<void(intrusive_ptr<Request>&&, intrusive_ptr<Response>&&)>& cb);
 
     void send(intrusive_ptr<Request>&& req);
@@ -43,6 +44,7 @@ private:
     bool _send(intrusive_ptr<Request>&& req);
 
     event::loop_ptr _loop;
+    event::TimerWheel& _wheel;
     PoolConfig _config;
     net::Domain _domain;
     bool _is_proxy = false;
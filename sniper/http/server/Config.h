@@ -17,6 +17,7 @@
 #pragma once
 
 #include <cstdint>
+#include <sniper/http/server/Status.h>
 #include <sniper/std/chrono.h>
 #include <sniper/std/memory.h>
 #include <sniper/std/string.h>
@@ -33,16 +34,79 @@ struct Config final : public intrusive_unsafe_ref_counter<Config>
     size_t max_free_conns = 1024;
 
     milliseconds keep_alive_timeout = 1min;
+    // time to receive request head and body, counted from their first byte (0 - disabled).
+    // Streamed bodies (Request::set_body_cb) are paced by user and limited only by keep_alive_timeout.
+    milliseconds header_read_timeout = 0ms;
+    milliseconds body_read_timeout = 0ms;
+    // connection timeouts are kept in a timer wheel with this precision
+    milliseconds timer_resolution = 100ms;
 
     uint32_t buffer_size = 8 * 1024;
     uint32_t buffer_renew_threshold = 10; // percent
     uint32_t request_max_size = 128 * 1024;
+    // Backpressure of HTTP/1.x connection (0 - unlimited): reading stops while max_pipeline requests are
+    // not answered or not written yet, or max_output bytes of responses are not written (file bodies are not
+    // counted), and resumes when output is drained. HTTP/2 is limited by http2_max_streams and flow control.
+    uint32_t max_pipeline = 0;
+    uint32_t max_output = 0;
+    // Fairness (0 - unlimited): work of one connection or listener per loop iteration, the rest waits
+    // for the next iteration and other ready connections. io_uring multishot accept is not limited.
+    uint32_t read_budget = 0;    // bytes read from connection
+    uint32_t request_budget = 0; // requests parsed from connection
+    uint32_t accept_budget = 0;  // connections accepted from listener
 
     string server_name = "libsniper";
 
     bool add_server_header = false;
     bool add_date_header = false;
 
+    // io_uring backend (Linux): multishot accept/recv with provided buffers, sendmsg.
+    // Falls back to libev if the kernel does not support it.
+    bool io_uring = false;
+    uint32_t io_uring_entries = 4096;
+    // power of 2, each one is buffer_size bytes. Connection with paused streamed body (Request::set_body_cb)
+    // may hold up to io_uring_buffers * buffer_size of already received data.
+    uint32_t io_uring_buffers = 1024;
+
+    // TLS (library built with SNIPER_TLS): PEM certificate chain and private key, empty - plain HTTP.
+    // Handshake is limited by header_read_timeout.
+    string tls_cert;
+    string tls_key;
+    // kernel TLS offload after the handshake: needs OpenSSL with ktls and kernel tls module, otherwise
+    // records are processed by OpenSSL. Connection without offload in both directions works via libev.
+    bool tls_ktls = true;
+    // session ticket key is replaced after this time, tickets of the previous key are accepted and renewed
+    // (0 - key is not rotated). Keys are shared by all servers of the process.
+    milliseconds tls_ticket_lifetime = 1h;
+
+    // HTTP/2 (library built with SNIPER_HTTP2): h2 by ALPN and h2c with prior knowledge.
+    // Request bodies are buffered up to request_max_size, stream callback is not used.
+    bool http2 = false;
+    uint32_t http2_max_streams = 128;
+    // receive window of connection, window of stream is request_max_size
+    uint32_t http2_window = 1024 * 1024;
+
+    // Overload control (0 - disabled). Loop lag is a delay of timer firing every overload_interval.
+    // New request is answered by prebuilt overload_status response without user callback when loop lag
+    // is above overload_lag or overload_requests are already in user code (passed to callback, not answered).
+    // Streamed bodies are buffered while overloaded.
+    milliseconds overload_interval = 10ms;
+    milliseconds overload_lag = 0ms;
+    size_t overload_requests = 0;
+    ResponseStatus overload_status = ResponseStatus::SERVICE_UNAVAILABLE;
+    // accept is paused while loop lag is above
+    milliseconds overload_accept_lag = 0ms;
+
+    // Request deadline (Request::deadline): budget in milliseconds from header or query param (OpenRTB tmax),
+    // deadline_default if both are absent (0 - no deadline). Param is found by scan of query string,
+    // Request::param() index is not built for it.
+    string deadline_header;
+    string deadline_param;
+    milliseconds deadline_default = 0ms;
+    // Connection::send replaces response to expired request by empty deadline_status response (no-bid)
+    bool deadline_drop = false;
+    ResponseStatus deadline_status = ResponseStatus::NO_CONTENT;
+
     // Normalizing (tolower)
     bool normalize = false; // method and headers names
     bool normalize_other = false; // path, headers values
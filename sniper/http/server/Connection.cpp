@@ -16,17 +16,38 @@
 
 #include <sniper/http/Buffer.h>
 #include <sniper/log/log.h>
+#include <sniper/net/socket.h>
 #include <sniper/std/check.h>
 #include <sniper/std/string.h>
+#include <sys/sendfile.h>
 #include <sys/uio.h>
 #include "Connection.h"
 #include "Config.h"
+#include "Inbox.h"
 #include "Pool.h"
 #include "Request.h"
 #include "Response.h"
+#include "Uring.h"
 
 namespace sniper::http::server {
 
+namespace {
+
+enum UringOp : uint8_t
+{
+    Recv = 0,
+    Send = 1
+};
+
+constexpr string_view h2_preface = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+// initial capacity of queues and io_uring iovecs, grown by pipelining and shrunk back when idle
+constexpr size_t min_queue = 16;
+constexpr size_t min_iov = 64;
+constexpr size_t max_iov = 1024;
+
+} // namespace
+
 Connection::Connection(event::loop_ptr loop, intrusive_ptr<Pool> pool, intrusive_ptr<Config> config) :
     _loop(std::move(loop)), _pool(std::move(pool)), _config(std::move(config))
 {
@@ -37,24 +58,27 @@ Connection::Connection(event::loop_ptr loop, intrusive_ptr<Pool> pool, intrusive
     check(_pool->_cb, "Callback not set");
     check(_config, "Config is nullptr");
 
-    if (_config->add_server_header && !_config->server_name.empty())
-        _server_name_header = fmt::format("Server: {}\r\n", _config->server_name);
-
-
-    _out.set_capacity(128);
-    _user.reserve(128);
+    _out.set_capacity(min_queue);
+    _user.reserve(min_queue);
 
     _w_read.set(*_loop);
     _w_write.set(*_loop);
     _w_close.set(*_loop);
     _w_user.set(*_loop);
-    _w_keep_alive_timeout.set(*_loop);
+    _w_defer.set(*_loop);
 
     _w_read.set<Connection, &Connection::cb_read>(this);
     _w_write.set<Connection, &Connection::cb_write>(this);
     _w_close.set<Connection, &Connection::cb_close>(this);
     _w_user.set<Connection, &Connection::cb_user>(this);
+    _w_defer.set<Connection, &Connection::cb_defer>(this);
     _w_keep_alive_timeout.set<Connection, &Connection::cb_keep_alive_timeout>(this);
+    _w_read_timeout.set<Connection, &Connection::cb_read_timeout>(this);
+
+    if (_pool->uring) {
+        _uring = _pool->uring.get();
+        _iov.resize(min_iov);
+    }
 }
 
 net::Peer Connection::peer() const noexcept
@@ -62,6 +86,11 @@ net::Peer Connection::peer() const noexcept
     return _peer;
 }
 
+bool Connection::is_busy() const noexcept
+{
+    return !_closed && (!_user.empty() || !_out.empty() || _stream || (_h2 && _h2->is_busy()));
+}
+
 void Connection::set(net::Peer peer, int fd) noexcept
 {
     log_trace(__PRETTY_FUNCTION__);
@@ -69,23 +98,86 @@ void Connection::set(net::Peer peer, int fd) noexcept
     _peer = peer;
     _fd = fd;
     _closed = false;
+    _serial = ++_pool->serial;
+
+    if (_config->keep_alive_timeout > 0ms)
+        _w_keep_alive_timeout.start(*_pool->wheel, _config->keep_alive_timeout, true);
+
+    _w_write.set(fd, ev::WRITE);
+    _uring_mode = _uring != nullptr;
 
-    if (_config->keep_alive_timeout > 0ms) {
-        double to_d = (double)duration_cast<milliseconds>(_config->keep_alive_timeout).count() / 1000.0;
-        _w_keep_alive_timeout.start(to_d, to_d);
+    // handshake is driven by libev watchers, connection moves to io_uring if the kernel takes over TLS
+    if (_pool->tls) {
+        if (!_tls.start(*_pool->tls, fd)) {
+            close();
+            return;
+        }
+
+        _uring_mode = false;
+        _read_phase = ReadPhase::Head;
+        if (_config->header_read_timeout > 0ms)
+            _w_read_timeout.start(*_pool->wheel, _config->header_read_timeout);
+    }
+
+    if (_uring_mode)
+        uring_recv();
+    else
+        start_read();
+}
+
+void Connection::start_read() noexcept
+{
+    _w_read.start(_fd, ev::READ);
+    _w_read.feed_event(0);
+}
+
+// true when requests can be read
+bool Connection::tls_handshake() noexcept
+{
+    switch (_tls.handshake()) {
+        case TlsState::Done:
+            break;
+        case TlsState::WantRead:
+            return false;
+        case TlsState::WantWrite:
+            _w_write.start();
+            return false;
+        default:
+            close();
+            return false;
     }
 
-    _buf = make_buffer(_config->buffer_size);
-    _pico = cache::STDCache<pico::Request>::get_unique();
+    update_read_phase(false);
 
-    if (!_buf || !_pico) {
+    if (_tls.alpn() == "h2" && !h2_start()) {
         close();
-        return;
+        return false;
     }
 
-    _w_read.start(fd, ev::READ);
-    _w_write.set(fd, ev::WRITE);
-    _w_read.feed_event(0);
+    // both directions are offloaded to kernel: plain socket for io_uring
+    if (_uring && !_tls.user_recv() && !_tls.user_send()) {
+        _w_read.stop();
+        _uring_mode = true;
+        uring_recv();
+        return false;
+    }
+
+    return true;
+}
+
+// TLS I/O is blocked by the other direction: wait for it instead of the ready one
+void Connection::tls_wait() noexcept
+{
+    if (_tls.user_recv() && _tls.want() == TlsState::WantWrite) {
+        _tls_read_on_write = true;
+        _w_read.stop();
+        _w_write.start();
+    }
+    else if (_tls.user_send() && _tls.want() == TlsState::WantRead) {
+        _tls_write_on_read = true;
+        _w_write.stop();
+        _w_read.start(_fd, ev::READ);
+    }
 }
 
 // internal call only from async callbacks
@@ -97,7 +189,19 @@ void Connection::close() noexcept
     _w_write.stop();
     _w_close.stop();
     _w_user.stop();
+    _w_defer.stop();
     _w_keep_alive_timeout.stop();
+    _w_read_timeout.stop();
+    _read_phase = ReadPhase::Idle;
+    _tls.reset();
+
+    if (_uring_mode) {
+        // complete in-flight operations, they keep file open
+        ::shutdown(_fd, SHUT_RDWR);
+        _recv_active = false;
+        _send_active = false;
+        _gen++;
+    }
 
     ::close(_fd);
     _closed = true;
@@ -105,10 +209,29 @@ void Connection::close() noexcept
     _closed = true;
     _processed = 0;
 
+    if (_stream) {
+        _stream->_body_cb = nullptr;
+        _stream.reset();
+    }
+    _stream_left = 0;
+    _paused = false;
+    _blocked = false;
+    _deferred = false;
+    _http1 = false;
+    _out_bytes = 0;
+    _tls_read_on_write = false;
+    _tls_write_on_read = false;
+
+    // late responses of closed connection are not sent
+    if (_pool)
+        _pool->requests -= _in_user;
+    _in_user = 0;
+
     _out.clear();
     _user.clear();
     _buf.reset();
     _pico.reset();
+    _h2.reset();
 
     if (_pool)
         _pool->disconnect(this);
@@ -140,25 +263,67 @@ void Connection::cb_read(ev::io& w, int revents) noexcept
     if (_closed)
         return;
 
+    if (!acquire()) {
+        close();
+        return;
+    }
+
+    // io_uring mode: data is already in buffer, called by resume
+    if (_uring_mode) {
+        if (process_buffer()) {
+            if (is_budget_spent(0))
+                defer_read();
+            else if (!_paused && !_blocked && !_deferred)
+                uring_recv();
+
+            start_user();
+            compact();
+        }
+        return;
+    }
+
+    if (_tls.in_handshake() && !tls_handshake())
+        return;
+
+    if (_tls_write_on_read) {
+        _tls_write_on_read = false;
+        _w_write.start();
+        _w_write.feed_event(ev::WRITE);
+
+        // watcher was started only for write
+        if (_paused || _blocked || _deferred) {
+            w.stop();
+            return;
+        }
+    }
+
+    size_t received = 0;
+
     while (true) {
-        if (auto state = _buf->read(_fd); state != BufferState::Error) { // BufferState::Again or BufferState::Full
-            if (!parse_buffer(*_config, _buf, _processed, _user, _out, _pico)) {
-                close();
-                return;
-            }
+        size_t size = _buf->size();
+        auto state = _tls.user_recv()
+                         ? _buf->read_with([this](char* data, size_t size) { return _tls.read(data, size); })
+                         : _buf->read(_fd);
 
-            if (_buf = renew_buffer(_buf, _config->buffer_renew_threshold, _config->request_max_size, _processed);
-                !_buf) {
-                close();
+        if (state != BufferState::Error) { // BufferState::Again or BufferState::Full
+            received += _buf->size() - size;
+
+            if (!process_buffer())
                 return;
-            }
 
-            // relaunch timeout timer
-            if (_w_keep_alive_timeout.is_active())
-                _w_keep_alive_timeout.again();
+            if (_paused || _blocked)
+                break;
+
+            // parsed requests are left in buffer or socket is not drained
+            if (is_budget_spent(state == BufferState::Again ? 0 : received)) {
+                defer_read();
+                break;
+            }
 
-            if (state == BufferState::Again)
+            if (state == BufferState::Again) {
+                tls_wait();
                 break;
+            }
 
             continue;
         }
@@ -168,185 +333,1146 @@ void Connection::cb_read(ev::io& w, int revents) noexcept
         }
     }
 
-    if (!_closed && !_user.empty() && !_w_user.is_active()) {
-        _w_user.start();
-        _w_user.feed_event(0);
+    start_user();
+    compact();
+}
+
+// idle keep-alive connection returns buffer and parser to caches, they are taken again on the next read
+void Connection::compact() noexcept
+{
+    if (_closed || !_buf || _stream || _paused || _blocked || _deferred || _tls.in_handshake()
+        || !_buf->tail(_processed).empty())
+        return;
+
+    bool idle = !is_busy();
+
+    // grown for a large request: the next one starts with default size
+    if (idle || _buf->capacity() > _config->buffer_size) {
+        _buf.reset();
+        _processed = 0;
+    }
+
+    if (!idle)
+        return;
+
+    _pico.reset();
+
+    if (_out.capacity() > min_queue)
+        _out.set_capacity(min_queue);
+
+    if (_user.capacity() > min_queue) {
+        decltype(_user)().swap(_user);
+        _user.reserve(min_queue);
     }
+
+    if (_iov.size() > min_iov && !_send_active)
+        decltype(_iov)(min_iov).swap(_iov);
 }
 
-WriteState Connection::cb_writev_int(ev::io& w) noexcept
+bool Connection::acquire() noexcept
 {
-    log_trace(__PRETTY_FUNCTION__);
+    if (!_buf) {
+        if (_buf = make_buffer(_config->buffer_size); !_buf)
+            return false;
+    }
 
-    while (!_out.empty() && _out.front()->_ready) {
-        std::array<iovec, 1024> iov{};
-        uint32_t iov_count = 0;
+    if (!_pico) {
+        if (_pico = cache::STDCache<pico::Request>::get_unique(); !_pico)
+            return false;
+    }
 
-        for (auto it = _out.begin(); iov_count < iov.size() && it != _out.end() && (*it)->_ready; ++it) {
-            if (auto count = (*it)->add_iov(iov.data() + iov_count, iov.size() - iov_count); count)
-                iov_count += count;
-            else
-                break;
-        }
+    return true;
+}
 
-        if (!iov_count)
-            return WriteState::Stop;
+bool Connection::process_buffer() noexcept
+{
+    if (!_h2 && !_http1 && _config->http2) {
+        // h2c with prior knowledge: connection preface in place of the first request
+        auto tail = _buf->tail(_processed);
+        auto size = std::min(tail.size(), h2_preface.size());
 
-        if (ssize_t size = writev(_fd, iov.data(), (int)iov_count); size > 0) {
-            for (auto it = _out.begin(); size && it != _out.end();) {
-                if (!(*it)->process_iov(size))
-                    break;
+        if (tail.substr(0, size) != h2_preface.substr(0, size)) {
+            _http1 = true;
+        }
+        else if (size < h2_preface.size()) {
+            return true;
+        }
+        else if (!h2_start()) {
+            close();
+            return false;
+        }
+    }
+
+    if (_h2)
+        return h2_recv();
 
-                if (!(*it)->keep_alive) {
-                    close();
-                    return WriteState::Error;
-                }
+    size_t parsed = _user.size();
 
-                ++it;
-                _out.pop_front();
+    while (!_paused) {
+        if (_stream) {
+            if (!stream_body()) {
+                close();
+                return false;
             }
+
+            // wait for the rest of body
+            if (_closed || _stream)
+                break;
+
+            continue;
         }
-        else if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
-            return WriteState::Again;
+
+        bool head = false;
+        if (!parse_buffer(*_config, _buf, _processed, _user, _out, _pico, _pool->_stream_cb ? &head : nullptr)) {
+            close();
+            return false;
         }
-        else if (size < 0 && errno == EINTR) {
-            continue;
+
+        if (!head)
+            break;
+
+        if (!stream_start()) {
+            close();
+            return false;
         }
-        else {
+    }
+
+    if (_closed)
+        return false;
+
+    // backpressure: the rest of buffer is parsed when responses are written
+    if (!_blocked && is_overflow())
+        block();
+
+    update_read_phase(_user.size() != parsed);
+
+    // parsing is stopped by backpressure or read budget: the tail holds complete requests, not a large one.
+    // libev reading is stopped till they are parsed, buffer is not renewed.
+    bool limited = _blocked || is_budget_spent(0);
+
+    if (!limited || _uring_mode) {
+        const char* old_tail = _buf->tail(_processed).data();
+
+        // paused io_uring recv is cancelled asynchronously: data already received by kernel
+        // into provided buffers is kept in connection buffer
+        uint32_t max_size = _config->request_max_size;
+        if ((_paused || _deferred || limited) && _uring_mode)
+            max_size += _config->io_uring_buffers * _config->buffer_size;
+
+        if (_buf = renew_buffer(_buf, _config->buffer_renew_threshold, max_size, _processed); !_buf) {
             close();
-            return WriteState::Error;
+            return false;
         }
+
+        // partially parsed request points to the old buffer
+        if (_pico->head_parsed && old_tail)
+            _pico->rebase(old_tail, _buf->tail(_processed).data());
     }
 
-    return WriteState::Stop;
+    // relaunch timeout timer
+    if (_w_keep_alive_timeout.is_active())
+        _w_keep_alive_timeout.again();
+
+    return true;
 }
 
-void Connection::cb_write(ev::io& w, int revents) noexcept
+// headers of request with body are parsed: ask user whether to stream the body
+bool Connection::stream_start() noexcept
 {
-    log_trace(__PRETTY_FUNCTION__);
+    auto req = make_request(_buf, std::move(_pico));
+    if (!req)
+        return false;
 
-    if (_closed)
-        return;
+    auto resp = make_response(req->minor_version(), req->keep_alive());
+    if (!resp)
+        return false;
 
-    if (cb_writev_int(w) == WriteState::Stop)
-        w.stop();
+    set_received(*_config, *req, *resp, steady_clock::now());
+
+    // overloaded: body is buffered and request is answered instead of the main callback
+    if (_pool->overload() != Overload::None) {
+        _pico = std::move(req->_pico);
+        return true;
+    }
+
+    try {
+        _pool->_stream_cb(intrusive_ptr(this), req, resp);
+    }
+    catch (std::exception& e) {
+        log_err("[Connection] Exception in stream callback: {}", e.what());
+    }
+    catch (...) {
+        log_err("[Connection] Exception in stream callback");
+    }
+
+    if (!req->_body_cb) {
+        // buffered body: continue parsing as usual
+        _pico = std::move(req->_pico);
+        return true;
+    }
+
+    if (_pico = cache::STDCache<pico::Request>::get_unique(); !_pico)
+        return false;
+
+    if (!resp->_ready)
+        to_user(*resp);
+
+    if (_out.full())
+        _out.set_capacity(2 * _out.capacity());
+
+    _out.push_back(std::move(resp));
+
+    _processed += req->_pico->header_size;
+    _stream_left = req->_pico->chunked ? 0 : req->_pico->content_length;
+    _stream = std::move(req);
+
+    return true;
 }
 
-void Connection::cb_user(ev::prepare& w, int revents) noexcept
+bool Connection::stream_body() noexcept
 {
-    log_trace(__PRETTY_FUNCTION__);
+    auto data = _buf->tail(_processed);
+    auto& parser = *_stream->_pico;
 
-    if (_closed || _user.empty())
-        return;
+    if (!parser.chunked) {
+        data = data.substr(0, _stream_left);
+        _stream_left -= data.size();
+        return stream_data(data, !_stream_left);
+    }
 
-    auto tmp = cache::Vector<tuple<intrusive_ptr<Request>, intrusive_ptr<Response>>>::get_unique(_user.capacity());
-    if (!tmp)
-        return;
+    if (data.empty())
+        return true;
 
-    tmp->swap(_user);
-    auto pool = _pool;
+    size_t size = data.size();
+    ssize_t rc = phr_decode_chunked(&parser.decoder, const_cast<char*>(data.data()), &size);
+    if (rc == -1)
+        return false;
 
-    for (auto& [req, resp] : *tmp) {
-        try {
-            pool->_cb(intrusive_ptr(this), req, resp);
-        }
-        catch (std::exception& e) {
-            log_err("[Connection] Exception in user callback: {}", e.what());
-        }
-        catch (...) {
-            log_err("[Connection] Exception in user callback");
-        }
+    if (size_t trimmed = data.size() - size - (rc > 0 ? rc : 0); trimmed && !_buf->resize(_buf->size() - trimmed))
+        return false;
 
-        if (_closed || _w_close.is_active())
-            return;
-    }
+    return stream_data(data.substr(0, size), rc >= 0);
+}
 
-    if (!_w_write.is_active()) {
-        cb_writev_int(_w_write);
+bool Connection::stream_data(string_view data, bool last) noexcept
+{
+    _processed += data.size();
 
-        if (!_out.empty() && _out.front()->_ready) {
-            _w_write.start();
-            _w_write.feed_event(0);
-        }
+    if (data.empty() && !last)
+        return true;
+
+    auto req = _stream;
+    if (last)
+        _stream.reset();
+
+    bool more = true;
+    try {
+        more = req->_body_cb(data, last);
+    }
+    catch (std::exception& e) {
+        log_err("[Connection] Exception in body callback: {}", e.what());
+    }
+    catch (...) {
+        log_err("[Connection] Exception in body callback");
     }
 
-    if (_user.empty())
-        w.stop();
+    if (last)
+        req->_body_cb = nullptr;
+    else if (!more)
+        pause();
+
+    return true;
 }
 
-void Connection::cb_keep_alive_timeout(ev::timer& w, int revents) noexcept
+void Connection::pause() noexcept
 {
-    log_trace(__PRETTY_FUNCTION__);
+    _paused = true;
 
-    close();
+    if (!_blocked)
+        stop_read();
 }
 
-void Connection::send(const intrusive_ptr<Response>& resp) noexcept
+// call from user
+void Connection::resume() noexcept
 {
     log_trace(__PRETTY_FUNCTION__);
 
-    if (resp && !_closed) {
-        if (_config->add_server_header)
-            resp->add_header_nocopy(_server_name_header);
+    if (_closed || !_paused)
+        return;
 
-        if (_config->add_date_header)
-            resp->_date = _pool->date;
+    _paused = false;
 
-        if (!resp->set_ready()) {
-            if (!_w_close.is_active()) {
-                _w_close.start();
-                _w_close.feed_event(0);
-            }
-            return;
-        }
+    if (!_blocked && !_deferred)
+        continue_read();
+}
 
-        if (!_w_write.is_active() && !_out.empty() && _out.front() == resp) {
-            _w_write.start();
-            _w_write.feed_event(0);
-        }
-    }
+// HTTP/1.x: too many pipelined requests or too much unwritten output
+bool Connection::is_overflow() const noexcept
+{
+    if (_config->max_pipeline && _out.size() >= _config->max_pipeline)
+        return true;
+
+    return _config->max_output && _out_bytes >= _config->max_output;
 }
 
-// call from pool close
-void Connection::detach() noexcept
+void Connection::block() noexcept
 {
-    log_trace(__PRETTY_FUNCTION__);
+    _blocked = true;
+    _pool->stats.read_blocks.fetch_add(1, std::memory_order_relaxed);
 
-    _pool.reset();
+    if (!_paused)
+        stop_read();
+}
 
-    if (!_closed)
-        close();
+// call after write: output is drained enough to read next requests
+void Connection::unblock() noexcept
+{
+    if (!_blocked || is_overflow())
+        return;
+
+    _blocked = false;
+
+    if (!_paused && !_deferred)
+        continue_read();
 }
 
-bool parse_buffer(const Config& config, const intrusive_ptr<Buffer>& buf, size_t& processed,
-                  vector<tuple<intrusive_ptr<Request>, intrusive_ptr<Response>>>& user,
-                  boost::circular_buffer<intrusive_ptr<Response>>& out,
-                  cache::STDCache<pico::Request>::unique& pico) noexcept
+// fairness: work of one connection in a loop iteration is limited
+bool Connection::is_budget_spent(size_t received) const noexcept
 {
-    log_trace(__PRETTY_FUNCTION__);
+    return (_config->request_budget && _user.size() >= _config->request_budget)
+           || (_config->read_budget && received >= _config->read_budget);
+}
 
-    auto data = buf->tail(processed);
+// The rest is processed on the next loop iteration together with other ready connections.
+// Zero timer instead of prepare watcher: loop does not block in poll while it is pending.
+void Connection::defer_read() noexcept
+{
+    if (_deferred)
+        return;
 
-    while (!data.empty()) {
-        if (auto res = pico->parse(data, config.request_max_size, config.normalize, config.normalize_other);
-            res == pico::ParseResult::Complete) { // request ready
+    _deferred = true;
+    if (!_paused && !_blocked)
+        stop_read();
 
-            string_view body;
-            if (pico->content_length) {
-                body = data.substr(pico->header_size, pico->content_length);
-                data.remove_prefix(pico->header_size + pico->content_length);
-                processed += pico->header_size + pico->content_length;
-            }
-            else {
-                data.remove_prefix(pico->header_size);
-                processed += pico->header_size;
-            }
+    _w_defer.start(0, 0);
+}
 
-            auto req = make_request(buf, std::move(pico), body);
-            auto resp = make_response(req->minor_version(), req->keep_alive());
+void Connection::cb_defer(ev::timer& w, int revents) noexcept
+{
+    log_trace(__PRETTY_FUNCTION__);
 
-            if (!req || !resp)
-                return false;
+    _deferred = false;
+
+    if (_closed || _paused || _blocked)
+        return;
+
+    if (!acquire()) {
+        close();
+        return;
+    }
+
+    // already received requests first: buffer does not grow while budget is spent on it
+    if (!process_buffer())
+        return;
+
+    bool spent = is_budget_spent(0);
+    start_user();
+
+    if (spent)
+        defer_read();
+    else if (!_closed && !_paused && !_blocked)
+        continue_read();
+
+    compact();
+}
+
+void Connection::stop_read() noexcept
+{
+    if (!_uring_mode)
+        _w_read.stop();
+    else if (_recv_active && !_uring->ring.prep_cancel(this, UringOp::Recv, _gen))
+        log_warn("[Connection] cannot pause io_uring recv");
+}
+
+void Connection::continue_read() noexcept
+{
+    // process already received data
+    if (!_uring_mode)
+        _w_read.start(_fd, ev::READ);
+
+    _w_read.feed_event(ev::READ);
+}
+
+void Connection::start_user() noexcept
+{
+    if (!_closed && !_user.empty() && !_w_user.is_active()) {
+        _w_user.start();
+        _w_user.feed_event(0);
+    }
+}
+
+uint32_t Connection::prepare_iov(iovec* iov, uint32_t max_count) noexcept
+{
+    uint32_t iov_count = 0;
+
+    for (auto it = _out.begin(); iov_count < max_count && it != _out.end() && (*it)->_ready; ++it) {
+        if (auto count = (*it)->add_iov(iov + iov_count, max_count - iov_count); count)
+            iov_count += count;
+        else
+            break;
+
+        // next responses wait for the end of stream or file
+        if ((*it)->is_open_stream() || (*it)->_file_left)
+            break;
+    }
+
+    return iov_count;
+}
+
+// return false if connection was closed
+bool Connection::complete_iov(ssize_t size) noexcept
+{
+    // written bytes are taken only from responses in _out
+    _out_bytes -= std::min((size_t)size, _out_bytes);
+
+    for (auto it = _out.begin(); size && it != _out.end();) {
+        if (!(*it)->process_iov(size))
+            break;
+
+        if (!(*it)->keep_alive) {
+            close();
+            return false;
+        }
+
+        ++it;
+        _out.pop_front();
+    }
+
+    unblock();
+    compact();
+
+    return true;
+}
+
+// send body from file of the first response
+WriteState Connection::write_file() noexcept
+{
+    auto& resp = *_out.front();
+
+    while (resp._file_left) {
+        auto count = std::min(resp._file_left, (size_t)1 << 30);
+        if (auto size = _tls.user_send() ? _tls.sendfile(resp._file_fd, &resp._file_offset, count)
+                                         : sendfile(_fd, resp._file_fd, &resp._file_offset, count);
+            size > 0) {
+            resp._file_left -= size;
+        }
+        else if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return WriteState::Again;
+        }
+        else if (size < 0 && errno == EINTR) {
+            continue;
+        }
+        else { // error or file was truncated
+            log_err("[Connection] cannot send file: {}", size < 0 ? strerror(errno) : "unexpected end of file");
+            close();
+            return WriteState::Error;
+        }
+    }
+
+    bool keep_alive = resp.keep_alive;
+    _out.pop_front();
+
+    if (!keep_alive) {
+        close();
+        return WriteState::Error;
+    }
+
+    unblock();
+    compact();
+
+    return WriteState::Stop;
+}
+
+// write pending file bodies of the first responses
+WriteState Connection::writev_file() noexcept
+{
+    while (!_out.empty() && _out.front()->_ready && _out.front()->is_file_pending())
+        if (auto state = write_file(); state != WriteState::Stop)
+            return state;
+
+    return WriteState::Stop;
+}
+
+WriteState Connection::cb_writev_int(ev::io& w) noexcept
+{
+    log_trace(__PRETTY_FUNCTION__);
+
+    while (!_out.empty() && _out.front()->_ready) {
+        if (auto state = writev_file(); state != WriteState::Stop)
+            return state;
+
+        if (_out.empty() || !_out.front()->_ready)
+            break;
+
+        std::array<iovec, 1024> iov{};
+
+        uint32_t iov_count = prepare_iov(iov.data(), iov.size());
+        if (!iov_count)
+            return WriteState::Stop;
+
+        if (ssize_t size = _tls.user_send() ? _tls.writev(iov.data(), iov_count)
+                                            : writev(_fd, iov.data(), (int)iov_count);
+            size > 0) {
+            if (!complete_iov(size))
+                return WriteState::Error;
+        }
+        else if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return WriteState::Again;
+        }
+        else if (size < 0 && errno == EINTR) {
+            continue;
+        }
+        else {
+            close();
+            return WriteState::Error;
+        }
+    }
+
+    return WriteState::Stop;
+}
+
+void Connection::cb_write(ev::io& w, int revents) noexcept
+{
+    log_trace(__PRETTY_FUNCTION__);
+
+    if (_closed)
+        return;
+
+    if (_tls_read_on_write) {
+        _tls_read_on_write = false;
+        if (!_paused && !_blocked && !_deferred)
+            continue_read();
+    }
+
+    if (_h2) {
+        if (auto state = h2_write(); state == WriteState::Stop)
+            w.stop();
+        else if (state == WriteState::Again)
+            tls_wait();
+        return;
+    }
+
+    if (_uring_mode) {
+        // watcher is started only while waiting for sendfile
+        w.stop();
+        uring_send();
+        return;
+    }
+
+    if (_tls.in_handshake()) {
+        w.stop();
+        if (tls_handshake())
+            _w_read.feed_event(ev::READ);
+        return;
+    }
+
+    if (auto state = cb_writev_int(w); state == WriteState::Stop)
+        w.stop();
+    else if (state == WriteState::Again)
+        tls_wait();
+}
+
+void Connection::cb_user(ev::prepare& w, int revents) noexcept
+{
+    log_trace(__PRETTY_FUNCTION__);
+
+    if (_closed || _user.empty())
+        return;
+
+    auto tmp = cache::Vector<tuple<intrusive_ptr<Request>, intrusive_ptr<Response>>>::get_unique(_user.capacity());
+    if (!tmp)
+        return;
+
+    tmp->swap(_user);
+    auto pool = _pool;
+
+    for (auto& [req, resp] : *tmp) {
+        if (shed(resp)) {
+            if (_closed || _w_close.is_active())
+                return;
+
+            continue;
+        }
+
+        to_user(*resp);
+
+        try {
+            pool->_cb(intrusive_ptr(this), req, resp);
+        }
+        catch (std::exception& e) {
+            log_err("[Connection] Exception in user callback: {}", e.what());
+        }
+        catch (...) {
+            log_err("[Connection] Exception in user callback");
+        }
+
+        if (_closed || _w_close.is_active())
+            return;
+    }
+
+    if (_h2) {
+        h2_start_write();
+    }
+    else if (_uring_mode) {
+        uring_send();
+    }
+    else if (!_w_write.is_active()) {
+        cb_writev_int(_w_write);
+
+        if (!_out.empty() && _out.front()->_ready) {
+            _w_write.start();
+            _w_write.feed_event(0);
+        }
+    }
+
+    if (_user.empty())
+        w.stop();
+}
+
+void Connection::cb_keep_alive_timeout(event::WheelTimer& w) noexcept
+{
+    log_trace(__PRETTY_FUNCTION__);
+
+    close();
+}
+
+// deadline is set when head or body starts and is not moved by next reads: trickling client is closed
+void Connection::update_read_phase(bool request_done) noexcept
+{
+    // blocked connection waits for its own output, not for the client
+    auto phase = ReadPhase::Idle;
+    if (!_stream && !_blocked && _buf && !_buf->tail(_processed).empty())
+        phase = _pico->head_parsed ? ReadPhase::Body : ReadPhase::Head;
+
+    if (phase == _read_phase && !request_done)
+        return;
+
+    _read_phase = phase;
+
+    auto timeout = 0ms;
+    if (phase == ReadPhase::Head)
+        timeout = _config->header_read_timeout;
+    else if (phase == ReadPhase::Body)
+        timeout = _config->body_read_timeout;
+
+    if (timeout > 0ms)
+        _w_read_timeout.start(*_pool->wheel, timeout);
+    else
+        _w_read_timeout.stop();
+}
+
+void Connection::cb_read_timeout(event::WheelTimer& w) noexcept
+{
+    log_trace(__PRETTY_FUNCTION__);
+
+    if (_read_phase == ReadPhase::Head)
+        _pool->stats.header_timeouts.fetch_add(1, std::memory_order_relaxed);
+    else
+        _pool->stats.body_timeouts.fetch_add(1, std::memory_order_relaxed);
+
+    close();
+}
+
+void Connection::send(const intrusive_ptr<Response>& resp) noexcept
+{
+    log_trace(__PRETTY_FUNCTION__);
+
+    if (resp && !_closed && !resp->_ready) {
+        from_user(*resp);
+
+        if (_config->deadline_drop && resp->_deadline != steady_clock::time_point::max()
+            && steady_clock::now() >= resp->_deadline) {
+            // late answer is useless for client: cheap no-bid instead of prepared one
+            resp->_headers.clear();
+            resp->set_frozen(*_pool->deadline_resp);
+            _pool->stats.deadline_drops.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (!prepare_send(resp) || (_h2 ? !_h2->submit(resp) : !resp->set_ready())) {
+            disconnect();
+            return;
+        }
+
+        if (_h2) {
+            h2_start_write();
+        }
+        else {
+            _out_bytes += resp->_total_size;
+            start_write(resp);
+        }
+    }
+}
+
+ConnectionHandle Connection::handle() noexcept
+{
+    if (_closed || !_pool || !_pool->inbox)
+        return {};
+
+    return ConnectionHandle(_pool->inbox, this, _serial);
+}
+
+ResponseHandle Connection::handle(const intrusive_ptr<Response>& resp) noexcept
+{
+    if (_closed || !resp || resp->_ready || !_pool || !_pool->inbox)
+        return {};
+
+    try {
+        _pool->handles.emplace(++_pool->handle_id, tuple(intrusive_ptr(this), _serial, resp));
+    }
+    catch (...) {
+        // OOM guard
+        return {};
+    }
+
+    return ResponseHandle(_pool->inbox, _pool->handle_id);
+}
+
+// call from pool: action of response handle
+void Connection::complete(InboxNode& node, const intrusive_ptr<Response>& resp) noexcept
+{
+    if (_closed || resp->_ready)
+        return;
+
+    if (node.type == InboxNode::Type::Cancel) {
+        log_warn("[Connection] response handle is destroyed without send, close connection");
+        disconnect();
+        return;
+    }
+
+    if (node.fill) {
+        try {
+            node.fill(*resp);
+        }
+        catch (std::exception& e) {
+            log_err("[Connection] Exception in response handle: {}", e.what());
+        }
+        catch (...) {
+            log_err("[Connection] Exception in response handle");
+        }
+    }
+
+    send(resp);
+}
+
+void Connection::send_stream(const intrusive_ptr<Response>& resp, bool last) noexcept
+{
+    log_trace(__PRETTY_FUNCTION__);
+
+    if (!resp || _closed || (resp->_ready && !resp->is_open_stream()))
+        return;
+
+    if (!resp->_ready)
+        from_user(*resp);
+
+    if (_h2) {
+        if ((!resp->_ready && !prepare_send(resp)) || !_h2->submit_stream(resp, last)) {
+            disconnect();
+            return;
+        }
+
+        h2_start_write();
+        return;
+    }
+
+    size_t size = resp->_total_size;
+
+    if (!resp->_ready && (!prepare_send(resp) || !resp->set_ready_stream())) {
+        disconnect();
+        return;
+    }
+
+    if (!resp->fill_chunks(last)) {
+        disconnect();
+        return;
+    }
+
+    _out_bytes += resp->_total_size - size;
+    start_write(resp);
+}
+
+// answer request by prebuilt response without user callback
+bool Connection::shed(const intrusive_ptr<Response>& resp) noexcept
+{
+    switch (_pool->overload()) {
+        case Overload::None:
+            return false;
+        case Overload::Lag:
+            _pool->stats.shed_lag.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case Overload::Requests:
+            _pool->stats.shed_requests.fetch_add(1, std::memory_order_relaxed);
+            break;
+    }
+
+    resp->set_frozen(*_pool->overload_resp);
+    send(resp);
+
+    return true;
+}
+
+void Connection::to_user(Response& resp) noexcept
+{
+    resp._in_user = true;
+    _in_user++;
+    _pool->requests++;
+}
+
+void Connection::from_user(Response& resp) noexcept
+{
+    if (!resp._in_user)
+        return;
+
+    resp._in_user = false;
+    if (_in_user) {
+        _in_user--;
+        _pool->requests--;
+    }
+}
+
+bool Connection::prepare_send(const intrusive_ptr<Response>& resp) noexcept
+{
+    try {
+        if (_config->add_server_header)
+            resp->add_header_copy(_pool->server_header);
+    }
+    catch (...) {
+        // OOM guard
+        return false;
+    }
+
+    if (_config->add_date_header)
+        resp->_date = _pool->date;
+
+    return true;
+}
+
+void Connection::start_write(const intrusive_ptr<Response>& resp) noexcept
+{
+    if (!_w_write.is_active() && !_out.empty() && _out.front() == resp) {
+        // io_uring mode: watcher is used only to defer and batch sends
+        if (!_uring_mode)
+            _w_write.start();
+
+        _w_write.feed_event(ev::WRITE);
+    }
+}
+
+bool Connection::h2_start() noexcept
+{
+    if (_h2 = cache::STDCache<Http2>::get_unique(); !_h2 || !_h2->start(*_config))
+        return false;
+
+    // frames are decoded into buffers of streams: connection buffer is not shared with requests anymore
+    auto tail = _buf ? _buf->tail(_processed) : string_view{};
+    if (_buf = make_buffer(std::max<size_t>(_config->buffer_size, tail.size()), tail); !_buf)
+        return false;
+
+    _processed = 0;
+    _read_phase = ReadPhase::Idle;
+    _w_read_timeout.stop();
+
+    // frames are small and flow control waits for WINDOW_UPDATE: Nagle delays every window by delayed ACK
+    if (!net::socket::tcp::set_no_delay(_fd))
+        log_warn("[Connection] cannot set TCP_NODELAY for HTTP/2");
+
+    // server preface
+    h2_start_write();
+
+    return true;
+}
+
+bool Connection::h2_recv() noexcept
+{
+    if (!_h2->recv(_buf->tail(_processed), _user)) {
+        close();
+        return false;
+    }
+
+    // everything is consumed by session
+    _processed = 0;
+    if (!_buf->resize(0)) {
+        close();
+        return false;
+    }
+
+    if (_w_keep_alive_timeout.is_active())
+        _w_keep_alive_timeout.again();
+
+    h2_start_write();
+
+    return true;
+}
+
+// deferred: frames of all streams from one loop iteration are written together
+void Connection::h2_start_write() noexcept
+{
+    if (!_w_write.is_active()) {
+        _w_write.start();
+        _w_write.feed_event(ev::WRITE);
+    }
+}
+
+WriteState Connection::h2_write() noexcept
+{
+    while (true) {
+        auto data = _h2->pending();
+        if (data.empty())
+            break;
+
+        iovec iov{const_cast<char*>(data.data()), data.size()};
+
+        if (ssize_t size = _tls.user_send() ? _tls.writev(&iov, 1) : writev(_fd, &iov, 1); size > 0) {
+            _h2->sent(size);
+        }
+        else if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return WriteState::Again;
+        }
+        else if (size < 0 && errno == EINTR) {
+            continue;
+        }
+        else {
+            close();
+            return WriteState::Error;
+        }
+    }
+
+    if (_h2->is_done()) {
+        close();
+        return WriteState::Error;
+    }
+
+    compact();
+
+    return WriteState::Stop;
+}
+
+void Connection::uring_recv() noexcept
+{
+    if (_recv_active)
+        return;
+
+    if (!_uring->ring.prep_recv_multishot(_fd, this, UringOp::Recv, _gen)) {
+        // no free sqe
+        _uring_mode = false;
+        start_read();
+        return;
+    }
+
+    intrusive_ptr_add_ref(this);
+    _recv_active = true;
+}
+
+void Connection::uring_send() noexcept
+{
+    if (_send_active || _w_write.is_active())
+        return;
+
+    // file body is sent by sendfile directly, wait for writable socket if needed
+    if (auto state = writev_file(); state != WriteState::Stop) {
+        if (state == WriteState::Again)
+            _w_write.start();
+        return;
+    }
+
+    if (_out.empty() || !_out.front()->_ready)
+        return;
+
+    // previous message used all iovecs: pipelined responses are sent by larger batches
+    if (_msg.msg_iovlen == _iov.size() && _iov.size() < max_iov)
+        _iov.resize(std::min(2 * _iov.size(), max_iov));
+
+    uint32_t iov_count = prepare_iov(_iov.data(), _iov.size());
+    if (!iov_count)
+        return;
+
+    _msg = {};
+    _msg.msg_iov = _iov.data();
+    _msg.msg_iovlen = iov_count;
+
+    if (!_uring->ring.prep_sendmsg(_fd, &_msg, this, UringOp::Send, _gen)) {
+        // no free sqe: fallback to direct write
+        if (cb_writev_int(_w_write) == WriteState::Again)
+            _w_write.start();
+
+        return;
+    }
+
+    intrusive_ptr_add_ref(this);
+    _send_active = true;
+}
+
+void Connection::uring_data(string_view data) noexcept
+{
+    if (!acquire()) {
+        close();
+        return;
+    }
+
+    while (!data.empty()) {
+        auto count = _buf->append(data);
+        if (!count) {
+            close();
+            return;
+        }
+
+        data.remove_prefix(count);
+
+        if (!process_buffer())
+            return;
+    }
+
+    if (is_budget_spent(0))
+        defer_read();
+
+    start_user();
+    compact();
+}
+
+void Connection::cb_uring(uint8_t op, uint16_t tag, int res, uint32_t flags) noexcept
+{
+    log_trace(__PRETTY_FUNCTION__);
+
+    // last completion of operation returns its reference
+    intrusive_ptr<Connection> guard;
+    if (!event::Uring::has_more(flags))
+        guard = intrusive_ptr<Connection>(this, false);
+
+    bool current = !_closed && tag == _gen;
+
+    if (op == UringOp::Recv) {
+        if (current && !event::Uring::has_more(flags))
+            _recv_active = false;
+
+        string_view data;
+        if (event::Uring::has_buffer(flags))
+            data = _uring->get(event::Uring::buffer_id(flags), res);
+
+        if (current) {
+            if (res > 0) {
+                uring_data(data);
+            }
+            else if (res == -EINVAL || res == -EOPNOTSUPP) {
+                // kernel without multishot recv
+                _uring_mode = false;
+                start_read();
+            }
+            else if (res != -ENOBUFS && res != -EINTR && res != -ECANCELED) {
+                close();
+            }
+        }
+
+        if (event::Uring::has_buffer(flags))
+            _uring->recycle(event::Uring::buffer_id(flags));
+
+        if (!_closed && _uring_mode && !_recv_active && !_paused && !_blocked && !_deferred)
+            uring_recv();
+    }
+    else if (op == UringOp::Send && current) {
+        _send_active = false;
+
+        if (res > 0) {
+            if (complete_iov(res))
+                uring_send();
+        }
+        else if (res == -EINTR || res == -EAGAIN) {
+            uring_send();
+        }
+        else {
+            close();
+        }
+    }
+}
+
+// call from pool close
+void Connection::detach() noexcept
+{
+    log_trace(__PRETTY_FUNCTION__);
+
+    _pool.reset();
+
+    if (!_closed)
+        close();
+}
+
+bool parse_buffer(const Config& config, const intrusive_ptr<Buffer>& buf, size_t& processed,
+                  vector<tuple<intrusive_ptr<Request>, intrusive_ptr<Response>>>& user,
+                  boost::circular_buffer<intrusive_ptr<Response>>& out,
+                  cache::STDCache<pico::Request>::unique& pico, bool* stream_head) noexcept
+{
+    log_trace(__PRETTY_FUNCTION__);
+
+    auto data = buf->tail(processed);
+    steady_clock::time_point now; // the same receive time for requests of one read
+
+    while (!data.empty()) {
+        // backpressure: the rest is parsed when responses are written
+        if (config.max_pipeline && out.size() >= config.max_pipeline)
+            break;
+
+        // fairness: the rest is parsed on the next loop iteration
+        if (config.request_budget && user.size() >= config.request_budget)
+            break;
+
+        if (stream_head && !pico->head_parsed) {
+            // headers only: caller decides how to receive the body, its size is not limited here
+            if (auto res = pico->parse_head(data, config.normalize, config.normalize_other);
+                res != pico::ParseResult::Complete) {
+                if (config.request_max_size && data.size() >= config.request_max_size)
+                    return false;
+
+                return res != pico::ParseResult::Err;
+            }
+
+            pico->head_parsed = true;
+
+            if (pico->content_length || pico->chunked) {
+                *stream_head = true;
+                return true;
+            }
+        }
+
+        auto res = pico->parse(data, config.request_max_size, config.normalize, config.normalize_other);
+
+        if (res != pico::ParseResult::Err && pico->trimmed) {
+            // chunked body was decoded in place
+            data.remove_suffix(pico->trimmed);
+            if (!buf->resize(buf->size() - pico->trimmed))
+                return false;
+        }
+
+        if (res == pico::ParseResult::Complete) { // request ready
+
+            string_view body;
+            if (pico->content_length) {
+                body = data.substr(pico->header_size, pico->content_length);
+                data.remove_prefix(pico->header_size + pico->content_length);
+                processed += pico->header_size + pico->content_length;
+            }
+            else {
+                data.remove_prefix(pico->header_size);
+                processed += pico->header_size;
+            }
+
+            auto req = make_request(buf, std::move(pico), body);
+            auto resp = make_response(req->minor_version(), req->keep_alive());
+
+            if (!req || !resp)
+                return false;
+
+            if (now == steady_clock::time_point{})
+                now = steady_clock::now();
+
+            set_received(config, *req, *resp, now);
 
             if (out.full())
                 out.set_capacity(2 * out.capacity());
@@ -17,12 +17,19 @@
 #pragma once
 
 #include <boost/circular_buffer.hpp>
+#include <sniper/cache/Cache.h>
 #include <sniper/event/Loop.h>
+#include <sniper/event/TimerWheel.h>
+#include <sniper/event/Uring.h>
+#include <sniper/http/server/Handle.h>
+#include <sniper/http/server/Http2.h>
+#include <sniper/http/server/Tls.h>
 #include <sniper/net/Peer.h>
 #include <sniper/pico/Request.h>
 #include <sniper/std/string.h>
 #include <sniper/std/tuple.h>
 #include <sniper/std/vector.h>
+#include <sys/socket.h>
 
 namespace sniper::http {
 
@@ -39,32 +46,96 @@ enum class WriteState
     Error
 };
 
+// part of request being received, each one has own deadline
+enum class ReadPhase
+{
+    Idle,
+    Head,
+    Body
+};
+
 struct Config;
+struct InboxNode;
 struct Pool;
 struct Request;
 struct Response;
 struct Connection;
+struct Uring;
 
-struct Connection final : public intrusive_unsafe_ref_counter<Connection>
+struct Connection final : public intrusive_unsafe_ref_counter<Connection>, public event::UringHandler
 {
     Connection(event::loop_ptr loop, intrusive_ptr<Pool> pool, intrusive_ptr<Config> config);
 
     void set(net::Peer peer, int fd) noexcept;
     void send(const intrusive_ptr<Response>& resp) noexcept;
+    // Streaming response: the first call sends status and headers, every call sends chunks
+    // added by Response::add_chunk*, last == true ends the response.
+    void send_stream(const intrusive_ptr<Response>& resp, bool last = false) noexcept;
 
     void detach() noexcept;
     void disconnect() noexcept;
+    // continue reading of streamed request body after BodyCb returned false
+    void resume() noexcept;
+
+    // Call from server loop: handles to disconnect or send the response from other thread.
+    // Response of handle must not be sent directly.
+    [[nodiscard]] ConnectionHandle handle() noexcept;
+    [[nodiscard]] ResponseHandle handle(const intrusive_ptr<Response>& resp) noexcept;
 
     [[nodiscard]] net::Peer peer() const noexcept;
+    [[nodiscard]] bool is_busy() const noexcept;
 
 private:
-    void cb_keep_alive_timeout(ev::timer& w, [[maybe_unused]] int revents) noexcept;
+    friend struct Pool;
+
+    void cb_keep_alive_timeout(event::WheelTimer& w) noexcept;
+    void cb_read_timeout(event::WheelTimer& w) noexcept;
     void cb_read(ev::io& w, [[maybe_unused]] int revents) noexcept;
     void cb_write(ev::io& w, [[maybe_unused]] int revents) noexcept;
     void cb_close(ev::prepare& w, [[maybe_unused]] int revents) noexcept;
     void cb_user(ev::prepare& w, [[maybe_unused]] int revents) noexcept;
+    void cb_defer(ev::timer& w, [[maybe_unused]] int revents) noexcept;
+    void cb_uring(uint8_t op, uint16_t tag, int res, uint32_t flags) noexcept final;
     WriteState cb_writev_int(ev::io& w) noexcept;
-
+    [[nodiscard]] WriteState writev_file() noexcept;
+
+    void compact() noexcept;
+    [[nodiscard]] bool acquire() noexcept;
+    [[nodiscard]] bool process_buffer() noexcept;
+    void update_read_phase(bool request_done) noexcept;
+    [[nodiscard]] bool stream_start() noexcept;
+    [[nodiscard]] bool stream_body() noexcept;
+    [[nodiscard]] bool stream_data(string_view data, bool last) noexcept;
+    void pause() noexcept;
+    [[nodiscard]] bool is_overflow() const noexcept;
+    void block() noexcept;
+    void unblock() noexcept;
+    [[nodiscard]] bool is_budget_spent(size_t received) const noexcept;
+    void defer_read() noexcept;
+    void stop_read() noexcept;
+    void continue_read() noexcept;
+    void start_user() noexcept;
+    void start_write(const intrusive_ptr<Response>& resp) noexcept;
+    [[nodiscard]] bool shed(const intrusive_ptr<Response>& resp) noexcept;
+    void to_user(Response& resp) noexcept;
+    void from_user(Response& resp) noexcept;
+    [[nodiscard]] bool prepare_send(const intrusive_ptr<Response>& resp) noexcept;
+    [[nodiscard]] uint32_t prepare_iov(iovec* iov, uint32_t max_count) noexcept;
+    [[nodiscard]] bool complete_iov(ssize_t size) noexcept;
+    [[nodiscard]] WriteState write_file() noexcept;
+
+    void start_read() noexcept;
+    [[nodiscard]] bool tls_handshake() noexcept;
+    void tls_wait() noexcept;
+    [[nodiscard]] bool h2_start() noexcept;
+    [[nodiscard]] bool h2_recv() noexcept;
+    void h2_start_write() noexcept;
+    WriteState h2_write() noexcept;
+    void uring_recv() noexcept;
+    void uring_send() noexcept;
+    void uring_data(string_view data) noexcept;
+
+    void complete(InboxNode& node, const intrusive_ptr<Response>& resp) noexcept;
     void close() noexcept;
 
     event::loop_ptr _loop;
@@ -73,25 +144,55 @@ private:
     net::Peer _peer;
     int _fd = -1;
     bool _closed = true;
+    uint64_t _serial = 0; // unique in pool, handles of previous client are ignored
     size_t _processed = 0;
-    string _server_name_header;
 
     ev::io _w_read;
     ev::io _w_write;
     ev::prepare _w_close;
     ev::prepare _w_user;
-    ev::timer _w_keep_alive_timeout;
+    ev::timer _w_defer;
+    event::WheelTimer _w_keep_alive_timeout;
+    event::WheelTimer _w_read_timeout;
 
     intrusive_ptr<Buffer> _buf;
     boost::circular_buffer<intrusive_ptr<Response>> _out;
     vector<tuple<intrusive_ptr<Request>, intrusive_ptr<Response>>> _user;
     cache::STDCache<pico::Request>::unique _pico = cache::STDCache<pico::Request>::get_unique_empty();
+    ReadPhase _read_phase = ReadPhase::Idle;
+    TlsConn _tls;
+    cache::STDCache<Http2>::unique _h2 = cache::STDCache<Http2>::get_unique_empty();
+
+    // request with streamed body
+    intrusive_ptr<Request> _stream;
+    size_t _stream_left = 0; // not chunked body
+    bool _paused = false;
+    bool _blocked = false;  // backpressure: reading is stopped till output is drained
+    size_t _out_bytes = 0;  // unwritten bytes of responses in _out, file bodies are not counted
+    bool _deferred = false; // read budget of loop iteration is spent
+    bool _http1 = false;    // first bytes are not h2c preface
+    bool _tls_read_on_write = false; // TLS read is blocked till socket is writable
+    bool _tls_write_on_read = false; // TLS write is blocked till socket is readable
+
+    // responses counted in Pool::requests
+    size_t _in_user = 0;
+
+    // io_uring mode: each in-flight operation holds a reference to connection,
+    // completions of previous connection on this object are detected by generation
+    Uring* _uring = nullptr;
+    bool _uring_mode = false;
+    bool _recv_active = false;
+    bool _send_active = false;
+    uint16_t _gen = 0;
+    vector<iovec> _iov;
+    msghdr _msg{};
 };
 
 [[nodiscard]] bool parse_buffer(const Config& config, const intrusive_ptr<Buffer>& buf, size_t& processed,
                                 vector<tuple<intrusive_ptr<Request>, intrusive_ptr<Response>>>& user,
                                 boost::circular_buffer<intrusive_ptr<Response>>& out,
-                                cache::STDCache<pico::Request>::unique& pico) noexcept;
+                                cache::STDCache<pico::Request>::unique& pico,
+                                bool* stream_head = nullptr) noexcept;
 
 using ConnectionPtr = intrusive_ptr<Connection>;
 
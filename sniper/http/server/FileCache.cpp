@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <sniper/log/log.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "FileCache.h"
+
+namespace sniper::http::server {
+
+namespace {
+
+inline bool is_same(const File& file, const struct stat& st) noexcept
+{
+    return file.dev == st.st_dev && file.ino == st.st_ino && file.size == (size_t)st.st_size
+           && file.mtime.tv_sec == st.st_mtim.tv_sec && file.mtime.tv_nsec == st.st_mtim.tv_nsec;
+}
+
+} // namespace
+
+File::File(int fd, size_t size, dev_t dev, ino_t ino, timespec mtime) noexcept :
+    fd(fd), size(size), dev(dev), ino(ino), mtime(mtime)
+{}
+
+File::~File() noexcept
+{
+    if (fd >= 0)
+        ::close(fd);
+}
+
+intrusive_ptr<File> open_file(const string& path) noexcept
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat st
+    {};
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    if (auto file = make_intrusive_noexcept<File>(fd, st.st_size, st.st_dev, st.st_ino, st.st_mtim); file)
+        return file;
+
+    ::close(fd);
+    return nullptr;
+}
+
+FileCache::FileCache(milliseconds check_interval, size_t max_files) :
+    _check_interval(check_interval), _max_files(max_files)
+{
+    _files.reserve(_max_files);
+}
+
+intrusive_ptr<File> FileCache::get(const string& path) noexcept
+{
+    auto now = steady_clock::now();
+
+    if (auto it = _files.find(path); it != _files.end()) {
+        auto& e = it->second;
+        if (now - e.checked < _check_interval)
+            return e.file;
+
+        struct stat st
+        {};
+        if (stat(path.c_str(), &st) == 0 && is_same(*e.file, st)) {
+            e.checked = now;
+            return e.file;
+        }
+
+        // changed or removed
+        _files.erase(it);
+    }
+
+    auto file = open_file(path);
+    if (!file || !_max_files)
+        return file;
+
+    try {
+        if (_files.size() >= _max_files)
+            _files.erase(_files.begin());
+
+        _files.emplace(path, Entry{file, now});
+    }
+    catch (...) {
+        // OOM guard: file is returned without caching
+        log_err("[FileCache] cannot cache {}", path);
+    }
+
+    return file;
+}
+
+void FileCache::clear() noexcept
+{
+    _files.clear();
+}
+
+} // namespace sniper::http::server
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sniper/std/chrono.h>
+#include <sniper/std/map.h>
+#include <sniper/std/memory.h>
+#include <sniper/std/string.h>
+#include <sys/types.h>
+
+namespace sniper::http::server {
+
+// Opened file used as response body (Response::set_file), fd is closed with the last reference
+struct File final : public intrusive_unsafe_ref_counter<File>
+{
+    File(int fd, size_t size, dev_t dev, ino_t ino, timespec mtime) noexcept;
+    ~File() noexcept;
+
+    File(const File&) = delete;
+    File& operator=(const File&) = delete;
+
+    const int fd;
+    const size_t size;
+    const dev_t dev;
+    const ino_t ino;
+    const timespec mtime;
+};
+
+[[nodiscard]] intrusive_ptr<File> open_file(const string& path) noexcept;
+
+// Cache of opened files for one loop. File is checked by stat at most once per check_interval
+// and reopened if it was changed or replaced. Responses in flight keep old version.
+// max_files = 0 disables caching: every get opens the file.
+class FileCache final
+{
+public:
+    explicit FileCache(milliseconds check_interval = 1s, size_t max_files = 1024);
+
+    [[nodiscard]] intrusive_ptr<File> get(const string& path) noexcept;
+    void clear() noexcept;
+
+private:
+    struct Entry
+    {
+        intrusive_ptr<File> file;
+        steady_clock::time_point checked;
+    };
+
+    milliseconds _check_interval;
+    size_t _max_files;
+    unordered_map<string, Entry> _files;
+};
+
+} // namespace sniper::http::server
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <new>
+#include <sniper/cache/ArrayCache.h>
+#include <utility>
+#include "Handle.h"
+#include "Inbox.h"
+#include "Response.h"
+
+namespace sniper::http::server {
+
+namespace {
+
+bool push(const shared_ptr<Inbox>& inbox, InboxNode* node) noexcept
+{
+    if (!node)
+        return false;
+
+    if (!inbox->push(node)) {
+        delete node;
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
+ConnectionHandle::ConnectionHandle(shared_ptr<Inbox> inbox, Connection* conn, uint64_t serial) noexcept :
+    _inbox(std::move(inbox)), _conn(conn), _serial(serial)
+{
+    //
+}
+
+bool ConnectionHandle::disconnect() const noexcept
+{
+    if (!_inbox)
+        return false;
+
+    auto* node = new (std::nothrow) InboxNode;
+    if (node) {
+        node->type = InboxNode::Type::Disconnect;
+        node->id = _serial;
+        node->conn = _conn;
+    }
+
+    return push(_inbox, node);
+}
+
+ConnectionHandle::operator bool() const noexcept
+{
+    return (bool)_inbox;
+}
+
+ResponseHandle::ResponseHandle(shared_ptr<Inbox> inbox, uint64_t id) noexcept : _inbox(std::move(inbox)), _id(id)
+{
+    //
+}
+
+ResponseHandle::ResponseHandle(ResponseHandle&& other) noexcept :
+    _inbox(std::move(other._inbox)), _id(std::exchange(other._id, 0))
+{
+    //
+}
+
+ResponseHandle& ResponseHandle::operator=(ResponseHandle&& other) noexcept
+{
+    if (this != &other) {
+        cancel();
+        _inbox = std::move(other._inbox);
+        _id = std::exchange(other._id, 0);
+    }
+
+    return *this;
+}
+
+ResponseHandle::~ResponseHandle() noexcept
+{
+    cancel();
+}
+
+bool ResponseHandle::send(function<void(Response&)>&& fill) noexcept
+{
+    if (!_inbox)
+        return false;
+
+    // OOM: handle is kept, it is cancelled by destructor
+    auto* node = new (std::nothrow) InboxNode;
+    if (!node)
+        return false;
+
+    node->id = _id;
+    node->fill = std::move(fill);
+
+    _id = 0;
+    return push(std::exchange(_inbox, nullptr), node);
+}
+
+bool ResponseHandle::send(ResponseStatus code, string&& data) noexcept
+{
+    try {
+        return send([code, data = std::move(data)](Response& resp) mutable {
+            resp.code = code;
+
+            // body is swapped into a cached string of the loop thread: no copy
+            if (auto str = cache::StringCache::get_unique(); str) {
+                str->swap(data);
+                resp.set_data(std::move(str));
+            }
+            else {
+                resp.set_data_copy(data);
+            }
+        });
+    }
+    catch (...) {
+        // OOM guard: handle is cancelled by destructor
+        return false;
+    }
+}
+
+ResponseHandle::operator bool() const noexcept
+{
+    return (bool)_inbox;
+}
+
+void ResponseHandle::cancel() noexcept
+{
+    if (!_inbox)
+        return;
+
+    auto* node = new (std::nothrow) InboxNode;
+    if (node) {
+        node->type = InboxNode::Type::Cancel;
+        node->id = _id;
+    }
+
+    _id = 0;
+    (void)push(std::exchange(_inbox, nullptr), node);
+}
+
+} // namespace sniper::http::server
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <sniper/http/server/Status.h>
+#include <sniper/std/functional.h>
+#include <sniper/std/memory.h>
+#include <sniper/std/string.h>
+
+namespace sniper::http::server {
+
+class Inbox;
+struct Connection;
+struct Response;
+
+// Connection and response of server loop for other threads. Handles are taken on the server loop by
+// Connection::handle, then moved to and used from any thread. Actions are applied on the server loop in order
+// and ignored if the connection was closed or the server was stopped meanwhile.
+class ConnectionHandle final
+{
+public:
+    ConnectionHandle() = default;
+
+    // any thread, false if server is stopped
+    bool disconnect() const noexcept;
+
+    explicit operator bool() const noexcept;
+
+private:
+    friend struct Connection;
+    ConnectionHandle(shared_ptr<Inbox> inbox, Connection* conn, uint64_t serial) noexcept;
+
+    shared_ptr<Inbox> _inbox;
+    Connection* _conn = nullptr;
+    uint64_t _serial = 0;
+};
+
+// Response is sent once, handle is empty after send. Handle destroyed without send closes the connection:
+// client would wait for the response forever.
+class ResponseHandle final
+{
+public:
+    ResponseHandle() = default;
+    ResponseHandle(ResponseHandle&& other) noexcept;
+    ResponseHandle& operator=(ResponseHandle&& other) noexcept;
+    ~ResponseHandle() noexcept;
+
+    // any thread, fill is called on the server loop before sending. False if server is stopped, or if out of
+    // memory: then handle stays valid and send can be retried.
+    bool send(function<void(Response&)>&& fill = {}) noexcept;
+    bool send(ResponseStatus code, string&& data) noexcept;
+
+    explicit operator bool() const noexcept;
+
+private:
+    friend struct Connection;
+    ResponseHandle(shared_ptr<Inbox> inbox, uint64_t id) noexcept;
+
+    void cancel() noexcept;
+
+    shared_ptr<Inbox> _inbox;
+    uint64_t _id = 0;
+};
+
+} // namespace sniper::http::server
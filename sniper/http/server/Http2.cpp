@@ -0,0 +1,755 @@
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <sniper/http/Buffer.h>
+#include <sniper/log/log.h>
+#include "Config.h"
+#include "Http2.h"
+#include "Request.h"
+#include "Response.h"
+
+#ifdef SNIPER_HTTP2
+#include <fmt/format.h>
+#include <nghttp2/nghttp2.h>
+#include <sniper/std/boost_vector.h>
+#include <sniper/strings/ascii_case.h>
+#include <unistd.h>
+#endif
+
+namespace sniper::http::server {
+
+#ifdef SNIPER_HTTP2
+
+struct Http2Stream final
+{
+    void clear() noexcept;
+    // request is too large: stream is reset, next frames of it are ignored
+    void drop() noexcept;
+
+    int32_t id = 0;
+    size_t idx = 0; // in Http2::_streams
+    bool head = false; // HEAD request: response without body
+
+    // request: headers and body
+    intrusive_ptr<Buffer> buf;
+    cache::STDCache<pico::Request>::unique pico = cache::STDCache<pico::Request>::get_unique_empty();
+    size_t body_start = 0;
+    bool body = false;
+
+    // response: data or file (sent from response), streamed chunks
+    intrusive_ptr<Response> resp;
+    string_view data;
+    size_t offset = 0; // of data or current chunk
+    size_t chunk = 0;
+};
+
+using Http2StreamCache = cache::STDCache<Http2Stream>;
+
+void Http2Stream::clear() noexcept
+{
+    id = 0;
+    idx = 0;
+    head = false;
+    buf.reset();
+    pico.reset();
+    body_start = 0;
+    body = false;
+    resp.reset();
+    data = {};
+    offset = 0;
+    chunk = 0;
+}
+
+void Http2Stream::drop() noexcept
+{
+    buf.reset();
+    pico.reset();
+}
+
+namespace {
+
+// frames collected for one write
+constexpr size_t max_write = 64 * 1024;
+
+// headers not allowed in HTTP/2
+constexpr string_view connection_headers[] = {"connection", "keep-alive", "proxy-connection", "transfer-encoding",
+                                              "upgrade"};
+
+// buffer of stream grows up to request_max_size
+bool reserve(Http2Stream& s, const Config& config, size_t size) noexcept
+{
+    auto& buf = *s.buf;
+    if (buf.capacity() - buf.size() >= size)
+        return true;
+
+    size_t capacity = std::max(buf.capacity() * 2, buf.size() + size);
+    if (config.request_max_size && capacity > config.request_max_size) {
+        if (buf.size() + size > config.request_max_size)
+            return false;
+
+        capacity = config.request_max_size;
+    }
+
+    auto new_buf = make_buffer(capacity, buf.tail(0));
+    if (!new_buf)
+        return false;
+
+    s.pico->rebase(buf.data(), new_buf->data());
+    s.buf = std::move(new_buf);
+
+    return true;
+}
+
+// space is reserved
+string_view append(Http2Stream& s, string_view data) noexcept
+{
+    size_t offset = s.buf->size();
+    if (s.buf->append(data) != data.size())
+        return {};
+
+    return {s.buf->data() + offset, data.size()};
+}
+
+bool add_header(Http2Stream& s, const Config& config, string_view name, string_view value) noexcept
+{
+    auto& pico = *s.pico;
+
+    if (!name.empty() && name.front() == ':') {
+        if (name == ":method") {
+            if (!reserve(s, config, value.size()))
+                return false;
+
+            pico.method = append(s, value);
+            s.head = pico.method == "HEAD";
+            if (config.normalize)
+                strings::to_lower_ascii(const_cast<char*>(pico.method.data()), pico.method.size());
+        }
+        else if (name == ":path") {
+            if (!reserve(s, config, value.size()))
+                return false;
+
+            auto target = append(s, value);
+            if (config.normalize_other)
+                strings::to_lower_ascii(const_cast<char*>(target.data()), target.size());
+            pico.set_path(target);
+        }
+        else if (name == ":authority" && !pico.header(KnownHeader::Host).data()) {
+            // as Host of HTTP/1.1
+            return add_header(s, config, "host", value);
+        }
+
+        return true;
+    }
+
+    if (pico.headers.size() == pico.headers.capacity() || !reserve(s, config, name.size() + value.size()))
+        return false;
+
+    auto key = append(s, name);
+    auto val = append(s, value);
+    if (config.normalize_other)
+        strings::to_lower_ascii(const_cast<char*>(val.data()), val.size());
+
+    if (auto h = pico::known_header(key); h != KnownHeader::Unknown && !pico.known[static_cast<size_t>(h)])
+        pico.known[static_cast<size_t>(h)] = pico.headers.size() + 1;
+
+    pico.headers.emplace_back(key, val);
+
+    return true;
+}
+
+// "Name: value\r\n" lines, names are copied in lower case to names (reserved by caller)
+void add_lines(string_view block, string& names, small_vector<nghttp2_nv, 16>& nv)
+{
+    while (!block.empty()) {
+        auto pos = block.find('\n');
+        auto line = block.substr(0, pos);
+        block.remove_prefix(pos == string_view::npos ? block.size() : pos + 1);
+
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+
+        auto colon = line.find(':');
+        if (colon == string_view::npos || !colon)
+            continue;
+
+        auto name = line.substr(0, colon);
+        auto value = line.substr(colon + 1);
+        while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+            value.remove_prefix(1);
+        while (!value.empty() && (value.back() == ' ' || value.back() == '\t'))
+            value.remove_suffix(1);
+
+        bool skip = false;
+        for (auto h : connection_headers)
+            skip = skip || (name.size() == h.size() && strings::iequals(name, h));
+
+        if (skip)
+            continue;
+
+        auto offset = names.size();
+        names.append(name);
+        strings::to_lower_ascii(names.data() + offset, name.size());
+
+        nv.push_back({(uint8_t*)names.data() + offset, (uint8_t*)value.data(), name.size(), value.size(),
+                      NGHTTP2_NV_FLAG_NONE});
+    }
+}
+
+} // namespace
+
+struct Http2Callbacks final
+{
+    static const nghttp2_session_callbacks* get() noexcept;
+
+    static int begin_headers(nghttp2_session* session, const nghttp2_frame* frame, void* user_data) noexcept;
+    static int header(nghttp2_session* session, const nghttp2_frame* frame, const uint8_t* name, size_t name_len,
+                      const uint8_t* value, size_t value_len, uint8_t flags, void* user_data) noexcept;
+    static int data_chunk(nghttp2_session* session, uint8_t flags, int32_t id, const uint8_t* data, size_t size,
+                          void* user_data) noexcept;
+    static int frame_recv(nghttp2_session* session, const nghttp2_frame* frame, void* user_data) noexcept;
+    static int stream_close(nghttp2_session* session, int32_t id, uint32_t error_code, void* user_data) noexcept;
+    static ssize_t read_body(nghttp2_session* session, int32_t id, uint8_t* buf, size_t size, uint32_t* flags,
+                             nghttp2_data_source* source, void* user_data) noexcept;
+};
+
+const nghttp2_session_callbacks* Http2Callbacks::get() noexcept
+{
+    static const nghttp2_session_callbacks* callbacks = [] {
+        nghttp2_session_callbacks* cb = nullptr;
+        if (nghttp2_session_callbacks_new(&cb) != 0)
+            return cb;
+
+        nghttp2_session_callbacks_set_on_begin_headers_callback(cb, begin_headers);
+        nghttp2_session_callbacks_set_on_header_callback(cb, header);
+        nghttp2_session_callbacks_set_on_data_chunk_recv_callback(cb, data_chunk);
+        nghttp2_session_callbacks_set_on_frame_recv_callback(cb, frame_recv);
+        nghttp2_session_callbacks_set_on_stream_close_callback(cb, stream_close);
+        return cb;
+    }();
+
+    return callbacks;
+}
+
+int Http2Callbacks::begin_headers(nghttp2_session* session, const nghttp2_frame* frame, void* user_data) noexcept
+{
+    auto& h2 = *static_cast<Http2*>(user_data);
+
+    if (frame->hd.type != NGHTTP2_HEADERS || frame->headers.cat != NGHTTP2_HCAT_REQUEST)
+        return 0;
+
+    auto s = Http2StreamCache::get_raw();
+    if (!s)
+        return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;
+
+    s->buf = make_buffer(h2._config->buffer_size);
+    s->pico = cache::STDCache<pico::Request>::get_unique();
+    if (!s->buf || !s->pico) {
+        Http2StreamCache::release(s);
+        return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;
+    }
+
+    try {
+        s->idx = h2._streams.size();
+        h2._streams.emplace_back(s);
+    }
+    catch (...) {
+        // OOM guard
+        Http2StreamCache::release(s);
+        return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;
+    }
+
+    s->id = frame->hd.stream_id;
+    nghttp2_session_set_stream_user_data(session, s->id, s);
+
+    return 0;
+}
+
+int Http2Callbacks::header(nghttp2_session* session, const nghttp2_frame* frame, const uint8_t* name, size_t name_len,
+                           const uint8_t* value, size_t value_len, uint8_t flags, void* user_data) noexcept
+{
+    auto& h2 = *static_cast<Http2*>(user_data);
+
+    // trailers are ignored
+    auto s = h2.stream(frame->hd.stream_id);
+    if (!s || !s->pico || frame->headers.cat != NGHTTP2_HCAT_REQUEST)
+        return 0;
+
+    if (!add_header(*s, *h2._config, {(const char*)name, name_len}, {(const char*)value, value_len})) {
+        s->drop();
+        return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;
+    }
+
+    return 0;
+}
+
+int Http2Callbacks::data_chunk(nghttp2_session* session, uint8_t flags, int32_t id, const uint8_t* data, size_t size,
+                               void* user_data) noexcept
+{
+    auto& h2 = *static_cast<Http2*>(user_data);
+
+    auto s = h2.stream(id);
+    if (!s || !s->pico)
+        return 0;
+
+    if (!s->body) {
+        s->body = true;
+        s->body_start = s->buf->size();
+    }
+
+    if (!reserve(*s, *h2._config, size)) {
+        s->drop();
+        return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;
+    }
+
+    (void)append(*s, {(const char*)data, size});
+
+    return 0;
+}
+
+int Http2Callbacks::frame_recv(nghttp2_session* session, const nghttp2_frame* frame, void* user_data) noexcept
+{
+    auto& h2 = *static_cast<Http2*>(user_data);
+
+    if ((frame->hd.type != NGHTTP2_HEADERS && frame->hd.type != NGHTTP2_DATA)
+        || !(frame->hd.flags & NGHTTP2_FLAG_END_STREAM))
+        return 0;
+
+    auto s = h2.stream(frame->hd.stream_id);
+    if (!s || !s->pico)
+        return 0;
+
+    // request is complete: same as HTTP/1.1 one for user
+    string_view body;
+    if (s->body)
+        body = s->buf->tail(s->body_start);
+
+    s->pico->head_parsed = true;
+    s->pico->minor_version = 1;
+    s->pico->keep_alive = true;
+    s->pico->content_length = body.size();
+
+    auto req = make_request(std::move(s->buf), std::move(s->pico), body);
+    auto resp = make_response(0, true);
+
+    if (!req || !resp) {
+        nghttp2_submit_rst_stream(session, NGHTTP2_FLAG_NONE, s->id, NGHTTP2_INTERNAL_ERROR);
+        return 0;
+    }
+
+    resp->_h2_stream = s->id;
+    set_received(*h2._config, *req, *resp, steady_clock::now());
+
+    try {
+        h2._user->emplace_back(req, resp);
+    }
+    catch (...) {
+        // OOM guard
+        nghttp2_submit_rst_stream(session, NGHTTP2_FLAG_NONE, s->id, NGHTTP2_INTERNAL_ERROR);
+        return 0;
+    }
+
+    s->resp = std::move(resp);
+
+    return 0;
+}
+
+int Http2Callbacks::stream_close(nghttp2_session* session, int32_t id, uint32_t error_code, void* user_data) noexcept
+{
+    auto& h2 = *static_cast<Http2*>(user_data);
+
+    if (auto s = h2.stream(id); s)
+        h2.close_stream(s);
+
+    return 0;
+}
+
+ssize_t Http2Callbacks::read_body(nghttp2_session* session, int32_t id, uint8_t* buf, size_t size, uint32_t* flags,
+                                  nghttp2_data_source* source, void* user_data) noexcept
+{
+    auto& s = *static_cast<Http2Stream*>(source->ptr);
+    auto& resp = *s.resp;
+    size_t count = 0;
+
+    if (resp._stream) {
+        auto& chunks = resp._chunks;
+
+        for (; count < size && s.chunk < chunks.size(); s.offset = 0, s.chunk++) {
+            auto data = std::get<string_view>(chunks[s.chunk]).substr(s.offset);
+            auto n = std::min(size - count, data.size());
+            memcpy(buf + count, data.data(), n);
+            count += n;
+
+            if (n != data.size()) {
+                s.offset += n;
+                break;
+            }
+        }
+
+        // everything added is copied: release it and wait for next chunks
+        if (s.chunk == chunks.size()) {
+            chunks.clear();
+            s.chunk = 0;
+
+            if (resp._finished)
+                *flags |= NGHTTP2_DATA_FLAG_EOF;
+            else if (!count)
+                return NGHTTP2_ERR_DEFERRED;
+        }
+
+        return count;
+    }
+
+    count = std::min(size, s.data.size() - s.offset);
+    memcpy(buf, s.data.data() + s.offset, count);
+    s.offset += count;
+
+    while (count < size && resp._file_left) {
+        auto n = pread(resp._file_fd, buf + count, std::min(size - count, resp._file_left), resp._file_offset);
+        if (n < 0 && errno == EINTR)
+            continue;
+
+        if (n <= 0) { // error or file was truncated
+            log_err("[Http2] cannot send file: {}", n < 0 ? strerror(errno) : "unexpected end of file");
+            return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;
+        }
+
+        resp._file_offset += n;
+        resp._file_left -= n;
+        count += n;
+    }
+
+    if (s.offset == s.data.size() && !resp._file_left)
+        *flags |= NGHTTP2_DATA_FLAG_EOF;
+
+    return count;
+}
+
+bool http2_supported() noexcept
+{
+    return true;
+}
+
+Http2::~Http2() noexcept
+{
+    clear();
+}
+
+void Http2::clear() noexcept
+{
+    for (auto s : _streams)
+        Http2StreamCache::release(s);
+
+    _streams.clear();
+
+    if (_session) {
+        nghttp2_session_del(_session);
+        _session = nullptr;
+    }
+
+    _config = nullptr;
+    _failed = false;
+    _user = nullptr;
+    if (_out.capacity() > 2 * max_write)
+        string().swap(_out);
+    else
+        _out.clear();
+    _out_pos = 0;
+    _names.clear();
+}
+
+bool Http2::start(const Config& config) noexcept
+{
+    clear();
+    _config = &config;
+
+    auto callbacks = Http2Callbacks::get();
+    if (!callbacks || nghttp2_session_server_new(&_session, callbacks, this) != 0) {
+        _session = nullptr;
+        return false;
+    }
+
+    // stream window fits the largest request: body is received without waiting for WINDOW_UPDATE
+    uint32_t window = std::clamp<uint32_t>(config.request_max_size, NGHTTP2_INITIAL_WINDOW_SIZE,
+                                           NGHTTP2_MAX_WINDOW_SIZE);
+
+    nghttp2_settings_entry settings[] = {{NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, config.http2_max_streams},
+                                         {NGHTTP2_SETTINGS_INITIAL_WINDOW_SIZE, window},
+                                         {NGHTTP2_SETTINGS_MAX_HEADER_LIST_SIZE, config.request_max_size}};
+
+    size_t count = config.request_max_size ? 3 : 2;
+    int32_t conn_window = std::min<uint32_t>(config.http2_window, NGHTTP2_MAX_WINDOW_SIZE);
+
+    if (nghttp2_submit_settings(_session, NGHTTP2_FLAG_NONE, settings, count) != 0
+        || (conn_window > NGHTTP2_INITIAL_CONNECTION_WINDOW_SIZE
+            && nghttp2_session_set_local_window_size(_session, NGHTTP2_FLAG_NONE, 0, conn_window) != 0)) {
+        clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool Http2::recv(string_view data, vector<tuple<intrusive_ptr<Request>, intrusive_ptr<Response>>>& user) noexcept
+{
+    if (!_session)
+        return false;
+
+    _user = &user;
+    auto rc = nghttp2_session_mem_recv(_session, (const uint8_t*)data.data(), data.size());
+    _user = nullptr;
+
+    return rc == (ssize_t)data.size();
+}
+
+Http2Stream* Http2::stream(int32_t id) const noexcept
+{
+    if (!_session || !id)
+        return nullptr;
+
+    return static_cast<Http2Stream*>(nghttp2_session_get_stream_user_data(_session, id));
+}
+
+void Http2::close_stream(Http2Stream* s) noexcept
+{
+    nghttp2_session_set_stream_user_data(_session, s->id, nullptr);
+
+    _streams[s->idx] = _streams.back();
+    _streams[s->idx]->idx = s->idx;
+    _streams.pop_back();
+
+    Http2StreamCache::release(s);
+}
+
+bool Http2::submit(const intrusive_ptr<Response>& resp) noexcept
+{
+    auto s = stream(resp->_h2_stream);
+    resp->_ready = true;
+
+    if (!s || s->resp != resp)
+        return true;
+
+    return submit_headers(resp, *s, false);
+}
+
+bool Http2::submit_stream(const intrusive_ptr<Response>& resp, bool last) noexcept
+{
+    auto s = stream(resp->_h2_stream);
+
+    if (!s || s->resp != resp) {
+        resp->_ready = true;
+        resp->_stream = true;
+        resp->_finished = true;
+        return true;
+    }
+
+    if (last)
+        resp->_finished = true;
+
+    if (!resp->_ready) {
+        resp->_ready = true;
+        resp->_stream = true;
+        return submit_headers(resp, *s, true);
+    }
+
+    // data provider waits for chunks
+    nghttp2_session_resume_data(_session, s->id);
+
+    return true;
+}
+
+bool Http2::submit_headers(const intrusive_ptr<Response>& resp, Http2Stream& s, bool stream) noexcept
+{
+    string_view frozen_head;
+    if (resp->_frozen) {
+        // status line is replaced by :status, body follows content length
+        auto& head = resp->_frozen->_head[1];
+        if (auto pos = head.find('\n'); pos != string::npos)
+            frozen_head = string_view(head).substr(pos + 1);
+
+        auto& tail = resp->_frozen->_tail;
+        if (auto pos = tail.find("\r\n\r\n"); pos != string::npos)
+            s.data = string_view(tail).substr(pos + 4);
+
+        resp->_file.reset();
+        resp->_file_fd = -1;
+        resp->_file_left = 0;
+    }
+    else if (!stream) {
+        s.data = std::get<string_view>(resp->_data);
+    }
+
+    fmt::format_int status(static_cast<int>(resp->code));
+    fmt::format_int length(s.data.size() + resp->_file_left);
+
+    try {
+        small_vector<nghttp2_nv, 16> nv;
+        nv.push_back({(uint8_t*)":status", (uint8_t*)status.data(), 7, status.size(), NGHTTP2_NV_FLAG_NONE});
+
+        // names are copied to one string: reserve it once, nv points into it
+        size_t size = frozen_head.size() + (resp->_date ? resp->_date->size() : 0);
+        for (auto& h : resp->_headers)
+            size += h.size;
+
+        _names.clear();
+        _names.reserve(size);
+
+        add_lines(frozen_head, _names, nv);
+        for (auto& h : resp->_headers)
+            add_lines({h.data ? h.data : resp->_arena.data() + h.offset, h.size}, _names, nv);
+
+        if (resp->_date) {
+            add_lines(*resp->_date, _names, nv);
+            resp->_date.reset();
+        }
+
+        if (!stream)
+            nv.push_back({(uint8_t*)"content-length", (uint8_t*)length.data(), 14, length.size(),
+                          NGHTTP2_NV_FLAG_NONE});
+
+        nghttp2_data_provider provider{};
+        provider.source.ptr = &s;
+        provider.read_callback = Http2Callbacks::read_body;
+
+        bool body = !s.head && (stream || !s.data.empty() || resp->_file_left);
+
+        auto rc = nghttp2_submit_response(_session, s.id, nv.data(), nv.size(), body ? &provider : nullptr);
+        return rc != NGHTTP2_ERR_NOMEM;
+    }
+    catch (...) {
+        // OOM guard
+        return false;
+    }
+}
+
+string_view Http2::pending() noexcept
+{
+    if (_out_pos == _out.size() && _session) {
+        _out.clear();
+        _out_pos = 0;
+
+        while (_out.size() < max_write) {
+            const uint8_t* data = nullptr;
+            auto size = nghttp2_session_mem_send(_session, &data);
+            if (size <= 0) {
+                _failed = _failed || size < 0;
+                break;
+            }
+
+            try {
+                _out.append((const char*)data, size);
+            }
+            catch (...) {
+                // OOM guard
+                _failed = true;
+                break;
+            }
+        }
+    }
+
+    return string_view(_out).substr(_out_pos);
+}
+
+void Http2::sent(size_t size) noexcept
+{
+    _out_pos = std::min(_out_pos + size, _out.size());
+}
+
+bool Http2::is_done() noexcept
+{
+    if (_failed || !_session)
+        return true;
+
+    return !nghttp2_session_want_read(_session) && !nghttp2_session_want_write(_session)
+           && _out_pos == _out.size();
+}
+
+bool Http2::is_busy() const noexcept
+{
+    for (auto s : _streams)
+        if (s->resp)
+            return true;
+
+    return false;
+}
+
+#else
+
+struct Http2Stream final
+{};
+
+bool http2_supported() noexcept
+{
+    return false;
+}
+
+Http2::~Http2() noexcept = default;
+
+void Http2::clear() noexcept {}
+
+bool Http2::start(const Config& config) noexcept
+{
+    log_err("[Http2] library is built without HTTP/2 support (SNIPER_HTTP2)");
+    return false;
+}
+
+bool Http2::recv(string_view data, vector<tuple<intrusive_ptr<Request>, intrusive_ptr<Response>>>& user) noexcept
+{
+    return false;
+}
+
+bool Http2::submit(const intrusive_ptr<Response>& resp) noexcept
+{
+    return false;
+}
+
+bool Http2::submit_stream(const intrusive_ptr<Response>& resp, bool last) noexcept
+{
+    return false;
+}
+
+string_view Http2::pending() noexcept
+{
+    return {};
+}
+
+void Http2::sent(size_t size) noexcept {}
+
+bool Http2::is_done() noexcept
+{
+    return true;
+}
+
+bool Http2::is_busy() const noexcept
+{
+    return false;
+}
+
+Http2Stream* Http2::stream(int32_t id) const noexcept
+{
+    return nullptr;
+}
+
+bool Http2::submit_headers(const intrusive_ptr<Response>& resp, Http2Stream& s, bool stream) noexcept
+{
+    return false;
+}
+
+void Http2::close_stream(Http2Stream* s) noexcept {}
+
+#endif
+
+} // namespace sniper::http::server
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sniper/std/memory.h>
+#include <sniper/std/string.h>
+#include <sniper/std/tuple.h>
+#include <sniper/std/vector.h>
+
+// nghttp2 types, its headers are not exposed to server users
+typedef struct nghttp2_session nghttp2_session;
+
+namespace sniper::http::server {
+
+struct Config;
+struct Request;
+struct Response;
+struct Http2Stream;
+struct Http2Callbacks;
+
+// library is built with nghttp2 (SNIPER_HTTP2)
+[[nodiscard]] bool http2_supported() noexcept;
+
+// HTTP/2 session of connection (nghttp2). Each stream is mapped onto Request/Response: headers are decoded
+// into pooled buffer of stream, body is appended after them and the complete request goes to user callback
+// as HTTP/1.1 one. Responses are sent by Connection::send/send_stream in any order, body of each stream
+// is limited by flow control of peer.
+struct Http2 final
+{
+    ~Http2() noexcept;
+    void clear() noexcept;
+
+    [[nodiscard]] bool start(const Config& config) noexcept;
+    // received bytes, complete requests are appended to user
+    [[nodiscard]] bool recv(string_view data,
+                            vector<tuple<intrusive_ptr<Request>, intrusive_ptr<Response>>>& user) noexcept;
+    // Response of its stream: headers and body. Response of stream reset by peer is dropped.
+    [[nodiscard]] bool submit(const intrusive_ptr<Response>& resp) noexcept;
+    // streaming response: the first call sends headers, every call sends chunks added to response
+    [[nodiscard]] bool submit_stream(const intrusive_ptr<Response>& resp, bool last) noexcept;
+
+    // frames to write, empty if there is nothing to send
+    [[nodiscard]] string_view pending() noexcept;
+    void sent(size_t size) noexcept;
+
+    // session is finished by GOAWAY or failed, connection can be closed
+    [[nodiscard]] bool is_done() noexcept;
+    // some stream has request in user callback or response not yet written
+    [[nodiscard]] bool is_busy() const noexcept;
+
+private:
+    friend struct Http2Callbacks;
+
+    [[nodiscard]] Http2Stream* stream(int32_t id) const noexcept;
+    [[nodiscard]] bool submit_headers(const intrusive_ptr<Response>& resp, Http2Stream& s, bool stream) noexcept;
+    void close_stream(Http2Stream* s) noexcept;
+
+    const Config* _config = nullptr;
+    nghttp2_session* _session = nullptr;
+    bool _failed = false;
+    vector<Http2Stream*> _streams; // open streams, returned to cache on close
+    vector<tuple<intrusive_ptr<Request>, intrusive_ptr<Response>>>* _user = nullptr; // target of recv
+
+    string _out; // frames collected for one write
+    size_t _out_pos = 0;
+    string _names; // lower case names of response headers being submitted
+};
+
+} // namespace sniper::http::server
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <sniper/std/check.h>
+#include <thread>
+#include "Inbox.h"
+#include "Pool.h"
+
+namespace sniper::http::server {
+
+Inbox::Inbox(const event::loop_ptr& loop, Pool* pool) : _pool(pool)
+{
+    check(loop, "[Inbox] loop is nullptr");
+    check(_pool, "[Inbox] pool is nullptr");
+
+    _w.set(*loop);
+    _w.set<Inbox, &Inbox::cb_async>(this);
+    _w.start();
+}
+
+Inbox::~Inbox() noexcept
+{
+    for (auto* node = take(); node;) {
+        auto* next = node->next;
+        delete node;
+        node = next;
+    }
+}
+
+bool Inbox::push(InboxNode* node) noexcept
+{
+    // close waits for pushes in progress: watcher is not used after it is stopped
+    _pushers.fetch_add(1);
+    if (_closed.load()) {
+        _pushers.fetch_sub(1);
+        return false;
+    }
+
+    auto* head = _head.load(std::memory_order_relaxed);
+    do {
+        node->next = head;
+    } while (!_head.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+
+    // queue was empty: nobody has woken the loop for this batch yet
+    if (!head)
+        _w.send();
+
+    _pushers.fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+void Inbox::close() noexcept
+{
+    _closed.store(true);
+    while (_pushers.load())
+        std::this_thread::yield();
+
+    _w.stop();
+    _pool = nullptr;
+
+    for (auto* node = take(); node;) {
+        auto* next = node->next;
+        delete node;
+        node = next;
+    }
+}
+
+// all queued nodes in push order
+InboxNode* Inbox::take() noexcept
+{
+    InboxNode* fifo = nullptr;
+
+    for (auto* node = _head.exchange(nullptr, std::memory_order_acquire); node;) {
+        auto* next = node->next;
+        node->next = fifo;
+        fifo = node;
+        node = next;
+    }
+
+    return fifo;
+}
+
+void Inbox::cb_async(ev::async& w, int revents) noexcept
+{
+    for (auto* node = take(); node;) {
+        auto* next = node->next;
+        if (_pool)
+            _pool->apply(*node);
+        delete node;
+        node = next;
+    }
+}
+
+} // namespace sniper::http::server
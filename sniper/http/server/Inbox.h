@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <sniper/event/Loop.h>
+#include <sniper/std/functional.h>
+
+namespace sniper::http::server {
+
+struct Connection;
+struct Pool;
+struct Response;
+
+// action of handle from other thread
+struct InboxNode final
+{
+    enum class Type : uint8_t
+    {
+        Send,
+        Cancel,
+        Disconnect
+    };
+
+    InboxNode* next = nullptr;
+    Type type = Type::Send;
+    uint64_t id = 0;            // response handle id or connection serial
+    Connection* conn = nullptr; // Disconnect only
+    function<void(Response&)> fill;
+};
+
+// Lock-free MPSC queue of handle actions. Producers push from any thread, the loop is woken up by one
+// ev::async per batch (only push to empty queue sends it) and takes the whole queue at once.
+// Owned by handles too: may outlive the server, but not its loop watcher (stopped by close).
+class Inbox final
+{
+public:
+    Inbox(const event::loop_ptr& loop, Pool* pool);
+    ~Inbox() noexcept;
+
+    // any thread, false if server is stopped: node is not taken
+    [[nodiscard]] bool push(InboxNode* node) noexcept;
+    // server loop: stop watcher, queued actions are dropped
+    void close() noexcept;
+
+private:
+    void cb_async(ev::async& w, [[maybe_unused]] int revents) noexcept;
+    [[nodiscard]] InboxNode* take() noexcept;
+
+    Pool* _pool;
+    ev::async _w;
+    std::atomic<InboxNode*> _head{nullptr};
+    std::atomic<uint32_t> _pushers{0};
+    std::atomic<bool> _closed{false};
+};
+
+} // namespace sniper::http::server
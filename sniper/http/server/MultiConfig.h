@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sniper/http/server/Config.h>
+#include <sniper/std/chrono.h>
+#include <sniper/std/vector.h>
+
+namespace sniper::http::server {
+
+struct MultiConfig final
+{
+    unsigned threads = 0; // 0 - number of cpus
+
+    // Pinning: worker N gets cpus[N % cpus.size()], otherwise all cpus of numa_nodes[N % numa_nodes.size()].
+    // Both empty - no pinning.
+    vector<unsigned> cpus;
+    vector<unsigned> numa_nodes;
+
+    // max time to finish in-flight requests on stop
+    milliseconds drain_timeout = 5s;
+
+    Config server;
+};
+
+} // namespace sniper::http::server
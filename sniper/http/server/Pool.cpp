@@ -18,8 +18,11 @@
 #include "Pool.h"
 #include "Config.h"
 #include "Connection.h"
+#include "Inbox.h"
 #include "Request.h"
 #include "Response.h"
+#include "Tls.h"
+#include "Uring.h"
 
 namespace sniper::http::server {
 
@@ -27,6 +30,11 @@ Pool::Pool(intrusive_ptr<Config> config) : _config(std::move(config))
 {
     _conns.reserve(_config->max_conns);
     _free_conns.reserve(_config->max_free_conns);
+
+    if (_config->add_server_header && !_config->server_name.empty())
+        server_header = "Server: " + _config->server_name + "\r\n";
+    overload_resp = make_unique<FrozenResponse>(_config->overload_status, std::initializer_list<string_view>{});
+    deadline_resp = make_unique<FrozenResponse>(_config->deadline_status, std::initializer_list<string_view>{});
 }
 
 Pool::~Pool()
@@ -63,6 +71,52 @@ void Pool::close() noexcept
 
     _free_conns.clear();
     _conns.clear();
+    handles.clear();
+
+    // wait for completions of detached connections
+    if (uring)
+        uring->close();
+}
+
+bool Pool::is_busy() const noexcept
+{
+    for (auto& e : _conns)
+        if (e.first->is_busy())
+            return true;
+
+    return false;
+}
+
+Overload Pool::overload() const noexcept
+{
+    if (_config->overload_lag > 0ms && loop_lag > _config->overload_lag)
+        return Overload::Lag;
+
+    if (_config->overload_requests && requests >= _config->overload_requests)
+        return Overload::Requests;
+
+    return Overload::None;
+}
+
+void Pool::apply(InboxNode& node) noexcept
+{
+    if (node.type == InboxNode::Type::Disconnect) {
+        auto it = _conns.find(node.conn);
+        if (it != _conns.end() && !it->first->_closed && it->first->_serial == node.id)
+            it->first->disconnect();
+        return;
+    }
+
+    auto it = handles.find(node.id);
+    if (it == handles.end())
+        return;
+
+    auto [conn, serial, resp] = std::move(it->second);
+    handles.erase(it);
+
+    // ignored if connection object was reused by another client
+    if (conn->_serial == serial)
+        conn->complete(node, resp);
 }
 
 // call from connection close
@@ -17,17 +17,34 @@
 #pragma once
 
 #include <sniper/event/Loop.h>
+#include <sniper/event/TimerWheel.h>
+#include <sniper/http/server/Stats.h>
 #include <sniper/std/functional.h>
+#include <sniper/std/chrono.h>
 #include <sniper/std/map.h>
 #include <sniper/std/memory.h>
+#include <sniper/std/tuple.h>
 #include <sniper/std/vector.h>
 
 namespace sniper::http::server {
 
+class FrozenResponse;
+class Inbox;
 struct Config;
 struct Connection;
+struct InboxNode;
 struct Request;
 struct Response;
+struct Tls;
+struct Uring;
+
+// reason to answer new request without user callback
+enum class Overload
+{
+    None,
+    Lag,
+    Requests
+};
 
 struct Pool final : public intrusive_unsafe_ref_counter<Pool>
 {
@@ -37,13 +54,37 @@ struct Pool final : public intrusive_unsafe_ref_counter<Pool>
     intrusive_ptr<Connection> get(const event::loop_ptr& loop, const intrusive_ptr<Pool>& pool) noexcept;
     void disconnect(Connection* conn) noexcept;
     void close() noexcept;
+    [[nodiscard]] bool is_busy() const noexcept;
+    [[nodiscard]] Overload overload() const noexcept;
+    // call from inbox: action of handle from other thread
+    void apply(InboxNode& node) noexcept;
 
     intrusive_ptr<Config> _config;
     unordered_map<Connection*, intrusive_ptr<Connection>> _conns;
     vector<intrusive_ptr<Connection>> _free_conns;
     function<void(const intrusive_ptr<Connection>&, const intrusive_ptr<Request>&, const intrusive_ptr<Response>&)> _cb;
+    function<void(const intrusive_ptr<Connection>&, const intrusive_ptr<Request>&, const intrusive_ptr<Response>&)>
+        _stream_cb;
 
     local_ptr<string> date;
+    string server_header; // empty if disabled
+    unique_ptr<Uring> uring;
+    unique_ptr<Tls> tls;
+    unique_ptr<event::TimerWheel> wheel;
+    Stats stats;
+
+    // overload control
+    unique_ptr<FrozenResponse> overload_resp;
+    steady_clock::duration loop_lag{};
+    size_t requests = 0; // passed to user callback and not answered yet
+
+    unique_ptr<FrozenResponse> deadline_resp;
+
+    // handles for other threads
+    shared_ptr<Inbox> inbox;
+    uint64_t serial = 0;    // of last accepted connection
+    uint64_t handle_id = 0; // of last response handle
+    unordered_map<uint64_t, tuple<intrusive_ptr<Connection>, uint64_t, intrusive_ptr<Response>>> handles;
 };
 
 } // namespace sniper::http::server
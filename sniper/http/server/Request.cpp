@@ -14,8 +14,13 @@
  * limitations under the License.
  */
 
+#include <charconv>
 #include <sniper/http/Buffer.h>
+#include <sniper/std/array.h>
+#include <sniper/strings/url.h>
 #include "Request.h"
+#include "Config.h"
+#include "Response.h"
 
 namespace sniper::http::server {
 
@@ -24,6 +29,62 @@ void Request::clear() noexcept
     _body = {};
     _buf.reset();
     _pico.reset();
+    _body_cb = nullptr;
+    _received = {};
+    _deadline = steady_clock::time_point::max();
+}
+
+bool Request::detach() noexcept
+{
+    if (!_buf || !_pico)
+        return true;
+
+    // bytes of this request in buffer
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    auto add = [&begin, &end](string_view sv) {
+        if (sv.empty())
+            return;
+
+        begin = begin ? std::min(begin, sv.data()) : sv.data();
+        end = end ? std::max(end, sv.data() + sv.size()) : sv.data() + sv.size();
+    };
+
+    add(_pico->method);
+    add(_pico->path);
+    add(_pico->qs);
+    add(_pico->fragment);
+    add(_body);
+    for (auto& [key, val] : _pico->headers) {
+        add(key);
+        add(val);
+    }
+
+    if (!begin)
+        return true;
+
+    size_t size = end - begin;
+
+    // own buffer of about request size
+    if (_buf->use_count() == 1 && _buf->capacity() < 2 * size)
+        return true;
+
+    auto buf = make_buffer(size, {begin, size});
+    if (!buf)
+        return false;
+
+    _pico->rebase(begin, buf->data());
+    if (!_body.empty())
+        _body = string_view(buf->data() + (_body.data() - begin), _body.size());
+
+    _buf = std::move(buf);
+
+    return true;
+}
+
+void Request::set_body_cb(BodyCb&& cb) noexcept
+{
+    _body_cb = std::move(cb);
 }
 
 string_view Request::data() const noexcept
@@ -90,6 +151,29 @@ string_view Request::fragment() const noexcept
     return {};
 }
 
+string_view Request::header(pico::KnownHeader h) const noexcept
+{
+    if (_pico)
+        return _pico->header(h);
+
+    return {};
+}
+
+string_view Request::header(string_view name) const noexcept
+{
+    if (!_pico)
+        return {};
+
+    if (auto h = pico::known_header(name); h != pico::KnownHeader::Unknown)
+        return _pico->header(h);
+
+    for (auto& [key, val] : _pico->headers)
+        if (key.size() == name.size() && strncasecmp(key.data(), name.data(), name.size()) == 0)
+            return val;
+
+    return {};
+}
+
 const static_vector<pair_sv, pico::MAX_HEADERS>& Request::headers() const noexcept
 {
     if (_pico)
@@ -101,11 +185,114 @@ const static_vector<pair_sv, pico::MAX_HEADERS>& Request::headers() const noexce
 const small_vector<pair_sv, pico::MAX_PARAMS>& Request::params() const noexcept
 {
     if (_pico)
-        return _pico->params;
+        return _pico->get_params();
 
     return _empty_params;
 }
 
+string_view Request::param(string_view key) const noexcept
+{
+    if (_pico)
+        return _pico->param(key);
+
+    return {};
+}
+
+steady_clock::time_point Request::received() const noexcept
+{
+    return _received;
+}
+
+steady_clock::time_point Request::deadline() const noexcept
+{
+    return _deadline;
+}
+
+milliseconds Request::budget() const noexcept
+{
+    if (_deadline == steady_clock::time_point::max())
+        return milliseconds::max();
+
+    if (auto now = steady_clock::now(); now < _deadline)
+        return duration_cast<milliseconds>(_deadline - now);
+
+    return 0ms;
+}
+
+bool Request::is_expired() const noexcept
+{
+    return _deadline != steady_clock::time_point::max() && steady_clock::now() >= _deadline;
+}
+
+bool Request::has_budget(milliseconds cost) const noexcept
+{
+    return _deadline == steady_clock::time_point::max() || steady_clock::now() + cost < _deadline;
+}
+
+namespace {
+
+// First value of key in query string without building the Request::param() index.
+// Percent-encoded key or value is decoded into buf, the one longer than buf is skipped.
+string_view find_param(string_view qs, string_view key, array<char, 32>& buf) noexcept
+{
+    for (string_view rest = qs; !rest.empty();) {
+        auto pos = rest.find('&');
+        auto p = rest.substr(0, pos);
+        auto eq = p.find('=');
+        auto k = p.substr(0, eq);
+        auto v = eq == string_view::npos ? string_view() : p.substr(eq + 1);
+
+        if (strings::is_url_encoded(k) && k.size() <= buf.size())
+            k = string_view(buf.data(), strings::url_decode(k, buf.data()));
+
+        if (k == key) {
+            if (!strings::is_url_encoded(v))
+                return v;
+
+            if (v.size() <= buf.size())
+                return string_view(buf.data(), strings::url_decode(v, buf.data()));
+
+            return {};
+        }
+
+        if (pos == string_view::npos)
+            break;
+
+        rest.remove_prefix(pos + 1);
+    }
+
+    return {};
+}
+
+} // namespace
+
+void set_received(const Config& config, Request& req, Response& resp, steady_clock::time_point now) noexcept
+{
+    req._received = now;
+
+    auto budget = config.deadline_default;
+
+    string_view value;
+    array<char, 32> buf;
+    if (!config.deadline_header.empty())
+        value = req.header(config.deadline_header);
+    if (value.empty() && !config.deadline_param.empty())
+        value = find_param(req.qs(), config.deadline_param, buf);
+
+    // invalid value: default budget
+    if (!value.empty()) {
+        uint32_t ms = 0;
+        if (auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), ms);
+            ec == std::errc() && end == value.data() + value.size())
+            budget = milliseconds(ms);
+    }
+
+    if (budget > 0ms) {
+        req._deadline = now + budget;
+        resp._deadline = req._deadline;
+    }
+}
+
 intrusive_ptr<Request> make_request(intrusive_ptr<Buffer> buf, cache::STDCache<pico::Request>::unique&& pico,
                                     string_view body) noexcept
 {
@@ -18,6 +18,8 @@
 
 #include <sniper/cache/Cache.h>
 #include <sniper/pico/Request.h>
+#include <sniper/std/chrono.h>
+#include <sniper/std/functional.h>
 #include <sniper/std/memory.h>
 
 namespace sniper::http {
@@ -28,8 +30,16 @@ struct Buffer;
 
 namespace sniper::http::server {
 
+struct Config;
+struct Connection;
 struct Request;
+struct Response;
 using RequestCache = cache::STDCache<Request>;
+using pico::KnownHeader;
+
+// Slice of streamed request body, valid only inside the callback. last == true on the end of body.
+// Return false to pause reading from connection until Connection::resume.
+using BodyCb = function<bool(string_view data, bool last)>;
 
 struct Request final : public intrusive_cache_unsafe_ref_counter<Request, RequestCache>
 {
@@ -45,15 +55,47 @@ struct Request final : public intrusive_cache_unsafe_ref_counter<Request, Reques
     [[nodiscard]] string_view fragment() const noexcept;
 
     [[nodiscard]] const static_vector<pair_sv, pico::MAX_HEADERS>& headers() const noexcept;
+    // value of the first header with this name, empty if not found. Known headers are found by index,
+    // other names (case-insensitive) by scanning headers.
+    [[nodiscard]] string_view header(pico::KnownHeader h) const noexcept;
+    [[nodiscard]] string_view header(string_view name) const noexcept;
+    // query params, parsed and percent-decoded on first access
     [[nodiscard]] const small_vector<pair_sv, pico::MAX_PARAMS>& params() const noexcept;
+    // value of the first param with this key (hash lookup), empty if not found
+    [[nodiscard]] string_view param(string_view key) const noexcept;
+
+    // Received: end of request, end of head for streamed one. Deadline: received plus budget in milliseconds
+    // from Config::deadline_header, Config::deadline_param or Config::deadline_default,
+    // time_point::max() if there is no deadline.
+    [[nodiscard]] steady_clock::time_point received() const noexcept;
+    [[nodiscard]] steady_clock::time_point deadline() const noexcept;
+    // time left till deadline: 0 if passed, milliseconds::max() if there is no deadline
+    [[nodiscard]] milliseconds budget() const noexcept;
+    [[nodiscard]] bool is_expired() const noexcept;
+    // whether downstream call taking about cost fits in deadline
+    [[nodiscard]] bool has_budget(milliseconds cost) const noexcept;
+
+    // Head and body point into the connection read buffer, a request kept by async handler keeps it alive.
+    // Copy them into own buffer of request size. Call from the handler owning the request before keeping it:
+    // views and params got before are invalidated.
+    [[nodiscard]] bool detach() noexcept;
+
+    // Call from stream callback of Server to receive body by slices instead of buffering it.
+    // If connection is closed before the end of body callback is not called anymore.
+    void set_body_cb(BodyCb&& cb) noexcept;
 
 private:
+    friend struct Connection;
     friend intrusive_ptr<Request> make_request(intrusive_ptr<Buffer> buf, cache::STDCache<pico::Request>::unique&& pico,
                                                string_view body) noexcept;
+    friend void set_received(const Config& config, Request& req, Response& resp, steady_clock::time_point now) noexcept;
 
     string_view _body;
     intrusive_ptr<Buffer> _buf;
     cache::STDCache<pico::Request>::unique _pico = cache::STDCache<pico::Request>::get_unique_empty();
+    BodyCb _body_cb;
+    steady_clock::time_point _received;
+    steady_clock::time_point _deadline = steady_clock::time_point::max();
 
     static_vector<pair_sv, pico::MAX_HEADERS> _empty_headers;
     small_vector<pair_sv, pico::MAX_PARAMS> _empty_params;
@@ -62,6 +104,9 @@ private:
 [[nodiscard]] intrusive_ptr<Request>
 make_request(intrusive_ptr<Buffer> buf, cache::STDCache<pico::Request>::unique&& pico, string_view body = {}) noexcept;
 
+// sets receive time and deadline of request and its response
+void set_received(const Config& config, Request& req, Response& resp, steady_clock::time_point now) noexcept;
+
 using RequestPtr = intrusive_ptr<Request>;
 
 } // namespace sniper::http::server
@@ -27,6 +27,14 @@ constexpr string_view connection_close = "Connection: close\r\n";
 constexpr string_view connection_keep_alive = "Connection: keep-alive\r\n";
 constexpr string_view content_length = "Content-Length: ";
 constexpr string_view content_length_0 = "Content-Length: 0\r\n\r\n";
+constexpr string_view transfer_encoding_chunked = "Transfer-Encoding: chunked\r\n\r\n";
+constexpr string_view headers_end = "\r\n";
+constexpr string_view chunk_end = "\r\n";
+constexpr string_view last_chunk = "0\r\n\r\n";
+
+// pooled response keeps arena capacity unless it was grown by unusually large headers
+constexpr size_t arena_reserve = 512;
+constexpr size_t arena_max_keep = 4096;
 
 inline uint32_t fill(string_view str, iovec& i) noexcept
 {
@@ -40,6 +48,42 @@ inline uint32_t fill(string_view str, iovec& i) noexcept
 
 } // namespace
 
+HeaderBlock::HeaderBlock(std::initializer_list<string_view> headers)
+{
+    for (auto header : headers) {
+        _data.append(header);
+        if (!header.empty() && header.back() != '\n')
+            _data.append("\r\n");
+    }
+}
+
+string_view HeaderBlock::view() const noexcept
+{
+    return _data;
+}
+
+FrozenResponse::FrozenResponse(ResponseStatus code, std::initializer_list<string_view> headers, string_view data) :
+    _code(code)
+{
+    for (int minor_version : {0, 1}) {
+        auto& head = _head[minor_version];
+        head.append(http_status(minor_version, code));
+
+        for (auto header : headers)
+            head.append(header);
+    }
+
+    _tail.append(content_length);
+    _tail.append(fmt::format_int(data.size()).str());
+    _tail.append("\r\n\r\n");
+    _tail.append(data);
+}
+
+ResponseStatus FrozenResponse::code() const noexcept
+{
+    return _code;
+}
+
 void Response::clear() noexcept
 {
     log_trace(__PRETTY_FUNCTION__);
@@ -47,12 +91,28 @@ void Response::clear() noexcept
     code = ResponseStatus::NOT_IMPLEMENTED;
 
     _ready = false;
+    _stream = false;
+    _finished = false;
+    _in_user = false;
     keep_alive = false;
     _minor_version = 0;
+    _h2_stream = 0;
+    _deadline = steady_clock::time_point::max();
 
     _first_header = {};
+    if (_arena.capacity() > arena_max_keep)
+        string().swap(_arena);
+    else
+        _arena.clear();
     _headers.clear();
     _data = {""sv, cache::StringCache::get_unique_empty()};
+    _frozen = nullptr;
+    _file.reset();
+    _file_fd = -1;
+    _file_offset = 0;
+    _file_left = 0;
+    _chunks.clear();
+    _chunks_filled = 0;
     _iov.clear();
     _processed = 0;
     _total_size = 0;
@@ -63,23 +123,19 @@ void Response::add_header_copy(string_view header)
 {
     log_trace(__PRETTY_FUNCTION__);
 
-    if (header.empty())
+    // iovecs point into arena after set_ready
+    if (header.empty() || _ready)
         return;
 
-    if (auto str = cache::StringCache::get_unique(header.size()); str) {
-        str->assign(header);
-
-        auto& h = _headers.emplace_back("", std::move(str));
-        std::get<0>(h) = *std::get<1>(h);
-    }
+    add_arena(header);
 }
 
 void Response::add_header_nocopy(string_view header)
 {
-    if (header.empty())
+    if (header.empty() || _ready)
         return;
 
-    _headers.emplace_back(header, cache::StringCache::get_unique_empty());
+    _headers.push_back({header.data(), 0, static_cast<uint32_t>(header.size())});
 }
 
 void Response::add_header(cache::String::unique&& header_ptr)
@@ -89,8 +145,29 @@ void Response::add_header(cache::String::unique&& header_ptr)
     if (!header_ptr)
         return;
 
-    auto& h = _headers.emplace_back("", std::move(header_ptr));
-    std::get<0>(h) = *std::get<1>(h);
+    add_header_copy(*header_ptr);
+}
+
+void Response::add_header_block(const HeaderBlock& block)
+{
+    log_trace(__PRETTY_FUNCTION__);
+
+    add_header_nocopy(block.view());
+}
+
+void Response::add_arena(string_view header)
+{
+    if (_arena.capacity() < arena_reserve)
+        _arena.reserve(arena_reserve);
+
+    auto offset = static_cast<uint32_t>(_arena.size());
+    _arena.append(header);
+
+    // consecutive copied headers are one iovec
+    if (!_headers.empty() && !_headers.back().data && _headers.back().offset + _headers.back().size == offset)
+        _headers.back().size += header.size();
+    else
+        _headers.push_back({nullptr, offset, static_cast<uint32_t>(header.size())});
 }
 
 void Response::set_data_copy(string_view data) noexcept
@@ -125,65 +202,254 @@ void Response::set_data(cache::String::unique&& data_ptr) noexcept
     std::get<0>(_data) = *std::get<1>(_data);
 }
 
-bool Response::set_ready() noexcept
+void Response::set_frozen(const FrozenResponse& frozen) noexcept
 {
     log_trace(__PRETTY_FUNCTION__);
 
-    if (_ready)
-        return true;
+    code = frozen._code;
+    _frozen = &frozen;
+}
+
+void Response::set_file(int fd, size_t offset, size_t size) noexcept
+{
+    log_trace(__PRETTY_FUNCTION__);
+
+    _data = {""sv, cache::StringCache::get_unique_empty()};
+    _file.reset();
+    _file_fd = fd;
+    _file_offset = offset;
+    _file_left = fd >= 0 ? size : 0;
+}
+
+void Response::set_file(intrusive_ptr<File> file, size_t offset, size_t size) noexcept
+{
+    log_trace(__PRETTY_FUNCTION__);
+
+    if (!file || offset > file->size)
+        return;
+
+    set_file(file->fd, offset, std::min(size, file->size - offset));
+    _file = std::move(file);
+}
+
+void Response::add_chunk_copy(string_view data)
+{
+    log_trace(__PRETTY_FUNCTION__);
+
+    if (data.empty() || _finished)
+        return;
+
+    // one piece: head + data + delimiter
+    if (auto str = cache::StringCache::get_unique(data.size() + 16 + chunk_end.size()); str) {
+        if (_minor_version)
+            fmt::format_to(std::back_inserter(*str), "{:x}\r\n", data.size());
+
+        str->append(data);
+
+        if (_minor_version)
+            str->append(chunk_end);
+
+        auto& c = _chunks.emplace_back("", std::move(str));
+        std::get<0>(c) = *std::get<1>(c);
+    }
+}
+
+void Response::add_chunk_nocopy(string_view data)
+{
+    log_trace(__PRETTY_FUNCTION__);
+
+    if (data.empty() || _finished)
+        return;
+
+    add_chunk_head(data.size());
+    _chunks.emplace_back(data, cache::StringCache::get_unique_empty());
+
+    if (_minor_version)
+        _chunks.emplace_back(chunk_end, cache::StringCache::get_unique_empty());
+}
+
+void Response::add_chunk(cache::String::unique&& data_ptr)
+{
+    log_trace(__PRETTY_FUNCTION__);
+
+    if (!data_ptr || data_ptr->empty() || _finished)
+        return;
+
+    add_chunk_head(data_ptr->size());
+
+    auto& c = _chunks.emplace_back("", std::move(data_ptr));
+    std::get<0>(c) = *std::get<1>(c);
+
+    if (_minor_version)
+        _chunks.emplace_back(chunk_end, cache::StringCache::get_unique_empty());
+}
+
+void Response::add_chunk_head(size_t size)
+{
+    if (!_minor_version)
+        return;
+
+    if (auto str = cache::StringCache::get_unique(16); str) {
+        fmt::format_to(std::back_inserter(*str), "{:x}\r\n", size);
+
+        auto& c = _chunks.emplace_back("", std::move(str));
+        std::get<0>(c) = *std::get<1>(c);
+    }
+}
+
+bool Response::fill_head() noexcept
+{
+    log_trace(__PRETTY_FUNCTION__);
 
     // first header
     _first_header = http_status(_minor_version, code);
 
-    // connection header
-    if (_minor_version == 0) {
-        if (keep_alive)
-            _headers.emplace_back(connection_keep_alive, cache::StringCache::get_unique_empty());
-        else
-            _headers.emplace_back(connection_close, cache::StringCache::get_unique_empty());
+    try {
+        // connection header
+        if (_minor_version == 0)
+            add_arena(keep_alive ? connection_keep_alive : connection_close);
+        else if (!keep_alive)
+            add_arena(connection_close);
+
+        // Date
+        if (_date) {
+            add_arena(*_date);
+            _date.reset();
+        }
     }
-    else if (!keep_alive) {
-        _headers.emplace_back(connection_close, cache::StringCache::get_unique_empty());
+    catch (...) {
+        // OOM guard
+        return false;
     }
 
-    // Date
-    if (_date)
-        _headers.emplace_back(*_date, cache::StringCache::get_unique_empty());
+    return true;
+}
+
+bool Response::set_ready() noexcept
+{
+    log_trace(__PRETTY_FUNCTION__);
+
+    if (_ready)
+        return true;
+
+    if (!fill_head())
+        return false;
+
+    // prebuilt status line and headers, content length is the head of frozen data
+    if (_frozen) {
+        _first_header = _frozen->_head[_minor_version ? 1 : 0];
+        _data = {_frozen->_tail, cache::StringCache::get_unique_empty()};
+        _file.reset();
+        _file_fd = -1;
+        _file_left = 0;
+        fill_iov();
+
+        _ready = true;
+        return true;
+    }
 
     // last header - content length
-    if (!std::get<string_view>(_data).empty()) {
-        fmt::format_int len(std::get<string_view>(_data).size());
+    try {
+        if (size_t size = _file_left ? _file_left : std::get<string_view>(_data).size(); size) {
+            fmt::format_int len(size);
 
-        auto str = cache::StringCache::get_unique(content_length.size() + len.size() + 4); // + \r\n\r\n
-        if (!str)
-            return false;
+            add_arena(content_length);
+            add_arena({len.data(), len.size()});
+            add_arena("\r\n\r\n");
+        }
+        else {
+            add_arena(content_length_0);
+        }
+    }
+    catch (...) {
+        // OOM guard
+        return false;
+    }
 
-        str->append(content_length);
-        str->append(len.data(), len.size());
-        str->append("\r\n\r\n");
+    fill_iov();
 
-        auto& h = _headers.emplace_back("", std::move(str));
-        std::get<0>(h) = *std::get<1>(h);
+    _ready = true;
+    return true;
+}
+
+bool Response::set_ready_stream() noexcept
+{
+    log_trace(__PRETTY_FUNCTION__);
+
+    if (_ready)
+        return _stream;
+
+    // HTTP/1.0: end of body is connection close
+    _stream = true;
+    if (_minor_version == 0)
+        keep_alive = false;
+
+    if (!fill_head())
+        return false;
+
+    // last header
+    try {
+        add_arena(_minor_version ? transfer_encoding_chunked : headers_end);
     }
-    else {
-        _headers.emplace_back(content_length_0, cache::StringCache::get_unique_empty());
+    catch (...) {
+        // OOM guard
+        return false;
     }
 
+    _data = {""sv, cache::StringCache::get_unique_empty()};
+    _file.reset();
+    _file_fd = -1;
+    _file_left = 0;
     fill_iov();
 
     _ready = true;
     return true;
 }
 
+bool Response::fill_chunks(bool last) noexcept
+{
+    log_trace(__PRETTY_FUNCTION__);
+
+    try {
+        for (; _chunks_filled < _chunks.size(); _chunks_filled++)
+            if (auto data = std::get<string_view>(_chunks[_chunks_filled]); !data.empty())
+                _total_size += fill(data, _iov.emplace_back());
+
+        if (last && !_finished) {
+            if (_minor_version)
+                _total_size += fill(last_chunk, _iov.emplace_back());
+
+            _finished = true;
+        }
+    }
+    catch (...) {
+        // OOM guard
+        return false;
+    }
+
+    return true;
+}
+
+bool Response::is_open_stream() const noexcept
+{
+    return _stream && !_finished;
+}
+
+// headers are written, body from file is not
+bool Response::is_file_pending() const noexcept
+{
+    return _file_left && _processed == _iov.size();
+}
+
 void Response::fill_iov() noexcept
 {
     log_trace(__PRETTY_FUNCTION__);
 
     _total_size += fill(_first_header, _iov.emplace_back());
 
+    // arena is not modified after this point
     for (auto& h : _headers)
-        if (!std::get<string_view>(h).empty())
-            _total_size += fill(std::get<string_view>(h), _iov.emplace_back());
+        _total_size += fill({h.data ? h.data : _arena.data() + h.offset, h.size}, _iov.emplace_back());
 
     if (!std::get<string_view>(_data).empty())
         _total_size += fill(std::get<string_view>(_data), _iov.emplace_back());
@@ -194,7 +460,8 @@ uint32_t Response::add_iov(iovec* data, size_t max_size) noexcept
     log_trace("{}, ptr={}, max_count={}, iov count={}, processed={}", __PRETTY_FUNCTION__, (void*)data, max_size,
               _iov.size(), _processed);
 
-    if (auto count = (_iov.size() - _processed); count && count <= max_size) {
+    // streamed response can have more pieces than fit in one writev
+    if (auto count = std::min(_iov.size() - _processed, max_size); count) {
         memcpy(data, _iov.data() + _processed, count * sizeof(iovec));
         return count;
     }
@@ -208,7 +475,8 @@ bool Response::process_iov(ssize_t& size) noexcept
 
     if (_total_size <= size) {
         size -= _total_size;
-        return true;
+        _total_size = 0;
+        _processed = _iov.size();
     }
 
     for (unsigned i = _processed; size && i < _iov.size(); i++) {
@@ -218,6 +486,7 @@ bool Response::process_iov(ssize_t& size) noexcept
             _processed++;
         }
         else {
+            _iov[i].iov_base = static_cast<char*>(_iov[i].iov_base) + size;
             _iov[i].iov_len -= size;
             _total_size -= size;
             size = 0;
@@ -225,7 +494,19 @@ bool Response::process_iov(ssize_t& size) noexcept
         }
     }
 
-    return _processed == _iov.size();
+    if (_processed != _iov.size() || _file_left)
+        return false;
+
+    if (!is_open_stream())
+        return true;
+
+    // streaming: everything filled is written, release it and wait for next chunks
+    _chunks.erase(_chunks.begin(), _chunks.begin() + _chunks_filled);
+    _chunks_filled = 0;
+    _iov.clear();
+    _processed = 0;
+
+    return false;
 }
 
 } // namespace sniper::http::server
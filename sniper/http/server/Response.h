@@ -18,8 +18,10 @@
 
 #include <sniper/cache/ArrayCache.h>
 #include <sniper/cache/Cache.h>
+#include <sniper/http/server/FileCache.h>
 #include <sniper/http/server/Status.h>
 #include <sniper/std/boost_vector.h>
+#include <sniper/std/chrono.h>
 #include <sniper/std/memory.h>
 #include <sniper/std/string.h>
 #include <sniper/std/tuple.h>
@@ -28,11 +30,48 @@
 
 namespace sniper::http::server {
 
+struct Config;
 struct Connection;
+struct Request;
 struct Response;
 using ResponseCache = cache::STDCache<Response>;
 using Chunk = tuple<string_view, cache::String::unique>;
 
+// Precomputed header lines, built once and added to responses without copying:
+//   static const HeaderBlock block{"Content-Type: text/plain\r\n", "Cache-Control: no-cache\r\n"};
+// Block must outlive all responses it is added to.
+class HeaderBlock final
+{
+public:
+    HeaderBlock(std::initializer_list<string_view> headers);
+
+    [[nodiscard]] string_view view() const noexcept;
+
+private:
+    string _data;
+};
+
+// Byte-identical response (no-bid, health check) serialized once:
+//   static const FrozenResponse no_bid(ResponseStatus::NO_CONTENT, {"Content-Type: text/plain\r\n"});
+//   resp->set_frozen(no_bid);
+// Per send only Server, Connection, Date and headers added to the response are written besides it.
+// Frozen response must outlive all responses it is set to.
+class FrozenResponse final
+{
+public:
+    FrozenResponse(ResponseStatus code, std::initializer_list<string_view> headers, string_view data = {});
+
+    [[nodiscard]] ResponseStatus code() const noexcept;
+
+private:
+    friend struct Response;
+    friend struct Http2;
+
+    ResponseStatus _code;
+    string _head[2]; // status line and headers for HTTP/1.0 and HTTP/1.1
+    string _tail;    // content length and body
+};
+
 struct Response final : public intrusive_cache_unsafe_ref_counter<Response, ResponseCache>
 {
     void clear() noexcept;
@@ -44,28 +83,78 @@ struct Response final : public intrusive_cache_unsafe_ref_counter<Response, Resp
     void add_header_copy(string_view header);
     void add_header_nocopy(string_view header);
     void add_header(cache::String::unique&& header_ptr);
+    void add_header_block(const HeaderBlock& block);
 
     void set_data_copy(string_view data) noexcept;
     void set_data_nocopy(string_view data) noexcept;
     void set_data(cache::String::unique&& data_ptr) noexcept;
 
+    // Status, headers and body from frozen response, set_data* and set_file are ignored
+    void set_frozen(const FrozenResponse& frozen) noexcept;
+
+    // Body from file, sent by sendfile after headers. Raw fd must stay open until response is sent.
+    void set_file(int fd, size_t offset, size_t size) noexcept;
+    void set_file(intrusive_ptr<File> file, size_t offset = 0, size_t size = string_view::npos) noexcept;
+
+    // Streaming body, sent by Connection::send_stream (set_data* is not used).
+    // HTTP/1.1: chunked transfer encoding, HTTP/1.0: body till connection close.
+    void add_chunk_copy(string_view data);
+    void add_chunk_nocopy(string_view data);
+    void add_chunk(cache::String::unique&& data_ptr);
+
 private:
     friend struct Connection;
+    friend struct Http2;
+    friend struct Http2Callbacks;
     friend intrusive_ptr<Response> make_response(int minor_version, bool keep_alive) noexcept;
-
+    friend void set_received(const Config& config, Request& req, Response& resp, steady_clock::time_point now) noexcept;
+
+    // header line: external memory or range of _arena (data == nullptr)
+    struct Header
+    {
+        const char* data = nullptr;
+        uint32_t offset = 0;
+        uint32_t size = 0;
+    };
+
+    void add_arena(string_view header);
+    [[nodiscard]] bool fill_head() noexcept;
     void fill_iov() noexcept;
+    [[nodiscard]] bool fill_chunks(bool last) noexcept;
     [[nodiscard]] uint32_t add_iov(iovec* data, size_t max_size) noexcept;
     [[nodiscard]] bool process_iov(ssize_t& size) noexcept;
     [[nodiscard]] bool set_ready() noexcept;
+    [[nodiscard]] bool set_ready_stream() noexcept;
+    [[nodiscard]] bool is_open_stream() const noexcept;
+    [[nodiscard]] bool is_file_pending() const noexcept;
+    void add_chunk_head(size_t size);
 
     bool _ready = false;
+    bool _stream = false;
+    bool _finished = false;
+    bool _in_user = false; // counted in Pool::requests until sent
     int _minor_version = 0;
+    int32_t _h2_stream = 0; // HTTP/2 stream id
+    steady_clock::time_point _deadline = steady_clock::time_point::max(); // deadline of request
 
     string_view _first_header;
-    small_vector<Chunk, 32> _headers;
+    string _arena; // copied and generated headers, keeps capacity between responses
+    small_vector<Header, 8> _headers;
     Chunk _data{""sv, cache::StringCache::get_unique_empty()};
 
-    small_vector<iovec, 35> _iov;
+    const FrozenResponse* _frozen = nullptr;
+
+    // file body
+    intrusive_ptr<File> _file;
+    int _file_fd = -1;
+    off_t _file_offset = 0;
+    size_t _file_left = 0;
+
+    // streaming body: pieces (chunk heads, data, delimiters) are kept until written
+    small_vector<Chunk, 8> _chunks;
+    uint32_t _chunks_filled = 0;
+
+    small_vector<iovec, 16> _iov;
     uint32_t _processed = 0;
     uint32_t _total_size = 0;
     local_ptr<string> _date;
@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace sniper::http::server {
+
+// Counters of one server. Written only by server loop, can be read from any thread.
+struct Stats final
+{
+    std::atomic<uint64_t> header_timeouts{0}; // closed: request head was not received in header_read_timeout
+    std::atomic<uint64_t> body_timeouts{0};   // closed: request body was not received in body_read_timeout
+    std::atomic<uint64_t> read_blocks{0};     // reading stopped by max_pipeline or max_output till output is drained
+
+    // overload control
+    std::atomic<uint64_t> shed_lag{0};      // answered by overload_status: loop lag above overload_lag
+    std::atomic<uint64_t> shed_requests{0}; // answered by overload_status: overload_requests in user code
+    std::atomic<uint64_t> accept_pauses{0}; // accept stopped: loop lag above overload_accept_lag
+    std::atomic<uint64_t> loop_lag_us{0};   // last measured loop lag
+
+    std::atomic<uint64_t> deadline_drops{0}; // response replaced by deadline_status: request deadline passed
+};
+
+} // namespace sniper::http::server
@@ -0,0 +1,549 @@
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <sniper/log/log.h>
+#include <unistd.h>
+#include "Config.h"
+#include "Http2.h"
+#include "Tls.h"
+
+#ifdef SNIPER_TLS
+#include <cstring>
+#include <mutex>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/ssl.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#else
+#include <openssl/hmac.h>
+#endif
+#endif
+
+namespace sniper::http::server {
+
+#ifdef SNIPER_TLS
+
+namespace {
+
+// one TLS record
+constexpr size_t max_record = 16 * 1024;
+
+void log_ssl_err(string_view msg) noexcept
+{
+    char err[256] = {0};
+    ERR_error_string_n(ERR_get_error(), err, sizeof(err));
+    log_err("[Tls] {}: {}", msg, err);
+}
+
+struct TicketKey final
+{
+    unsigned char name[16];
+    unsigned char aes[32];
+    unsigned char hmac[32];
+};
+
+// Ticket keys of process: every loop and every server resume sessions of each other.
+// Current key encrypts new tickets, previous one only decrypts tickets of the last lifetime.
+class TicketKeys final
+{
+public:
+    static TicketKeys& instance() noexcept
+    {
+        static TicketKeys keys;
+        return keys;
+    }
+
+    [[nodiscard]] bool current(milliseconds lifetime, TicketKey& key) noexcept
+    {
+        std::lock_guard lock(_mutex);
+        roll(lifetime);
+
+        if (!_ready)
+            return false;
+
+        key = _keys[0];
+        return true;
+    }
+
+    // renew - ticket was encrypted by previous key
+    [[nodiscard]] bool find(milliseconds lifetime, const unsigned char* name, TicketKey& key, bool& renew) noexcept
+    {
+        std::lock_guard lock(_mutex);
+        roll(lifetime);
+
+        for (size_t i = 0; i < (_prev ? 2 : 1) && _ready; i++) {
+            if (memcmp(_keys[i].name, name, sizeof(key.name)) == 0) {
+                key = _keys[i];
+                renew = i > 0;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+private:
+    void roll(milliseconds lifetime) noexcept
+    {
+        auto now = steady_clock::now();
+        if (_ready && (lifetime <= 0ms || now - _created < lifetime))
+            return;
+
+        _prev = _ready && now - _created < 2 * lifetime;
+        _keys[1] = _keys[0];
+        _ready = RAND_bytes((unsigned char*)&_keys[0], sizeof(TicketKey)) == 1;
+        _created = now;
+    }
+
+    std::mutex _mutex;
+    TicketKey _keys[2] = {};
+    steady_clock::time_point _created;
+    bool _ready = false;
+    bool _prev = false;
+};
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+using TicketMac = EVP_MAC_CTX;
+
+bool init_mac(TicketMac* mac, const TicketKey& key) noexcept
+{
+    OSSL_PARAM params[] = {
+        OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, (void*)key.hmac, sizeof(key.hmac)),
+        OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, (char*)"SHA256", 0), OSSL_PARAM_construct_end()};
+
+    return EVP_MAC_CTX_set_params(mac, params) == 1;
+}
+#else
+using TicketMac = HMAC_CTX;
+
+bool init_mac(TicketMac* mac, const TicketKey& key) noexcept
+{
+    return HMAC_Init_ex(mac, key.hmac, sizeof(key.hmac), EVP_sha256(), nullptr) == 1;
+}
+#endif
+
+// 1 - key is set, 2 - ticket is accepted and renewed, 0 - no ticket is issued or accepted
+int cb_ticket(SSL* ssl, unsigned char* name, unsigned char* iv, EVP_CIPHER_CTX* cipher, TicketMac* mac,
+              int enc) noexcept
+{
+    auto* tls = static_cast<const Tls*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+    auto& keys = TicketKeys::instance();
+    TicketKey key;
+
+    if (enc) {
+        if (!keys.current(tls->ticket_lifetime, key) || RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc())) != 1)
+            return 0;
+
+        memcpy(name, key.name, sizeof(key.name));
+        if (EVP_EncryptInit_ex(cipher, EVP_aes_256_cbc(), nullptr, key.aes, iv) != 1 || !init_mac(mac, key))
+            return -1;
+
+        return 1;
+    }
+
+    bool renew = false;
+    if (!keys.find(tls->ticket_lifetime, name, key, renew))
+        return 0;
+
+    if (EVP_DecryptInit_ex(cipher, EVP_aes_256_cbc(), nullptr, key.aes, iv) != 1 || !init_mac(mac, key))
+        return -1;
+
+    return renew ? 2 : 1;
+}
+
+int cb_alpn(SSL* ssl, const unsigned char** out, unsigned char* out_len, const unsigned char* in, unsigned in_len,
+            void* arg) noexcept
+{
+    // in order of server preference
+    static constexpr unsigned char protos[] = "\x02h2\x08http/1.1";
+    bool http2 = static_cast<const Tls*>(arg)->http2;
+
+    if (SSL_select_next_proto((unsigned char**)out, out_len, http2 ? protos : protos + 3,
+                              http2 ? sizeof(protos) - 1 : sizeof(protos) - 4, in, in_len)
+        == OPENSSL_NPN_NEGOTIATED)
+        return SSL_TLSEXT_ERR_OK;
+
+    return SSL_TLSEXT_ERR_NOACK;
+}
+
+} // namespace
+
+Tls::Tls(const Config& config) noexcept
+{
+    ctx = SSL_CTX_new(TLS_server_method());
+    if (!ctx) {
+        log_ssl_err("cannot create context");
+        return;
+    }
+
+    SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+    SSL_CTX_set_options(ctx, SSL_OP_NO_RENEGOTIATION);
+#ifdef SSL_OP_IGNORE_UNEXPECTED_EOF
+    // peer closing socket without close_notify is a normal end of connection for HTTP
+    SSL_CTX_set_options(ctx, SSL_OP_IGNORE_UNEXPECTED_EOF);
+#endif
+#ifdef SSL_OP_ENABLE_KTLS
+    if (config.tls_ktls)
+        SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+#endif
+    SSL_CTX_set_mode(ctx, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    http2 = config.http2 && http2_supported();
+    SSL_CTX_set_alpn_select_cb(ctx, cb_alpn, this);
+
+    // stateless resumption only: no cache to share between loops
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+    ticket_lifetime = config.tls_ticket_lifetime;
+    if (ticket_lifetime > 0ms)
+        SSL_CTX_set_timeout(ctx, duration_cast<seconds>(2 * ticket_lifetime).count());
+
+    SSL_CTX_set_app_data(ctx, this);
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, cb_ticket);
+#else
+    SSL_CTX_set_tlsext_ticket_key_cb(ctx, cb_ticket);
+#endif
+
+    if (SSL_CTX_use_certificate_chain_file(ctx, config.tls_cert.c_str()) != 1) {
+        log_ssl_err(fmt::format("cannot load certificate {}", config.tls_cert));
+        reset();
+        return;
+    }
+
+    if (SSL_CTX_use_PrivateKey_file(ctx, config.tls_key.c_str(), SSL_FILETYPE_PEM) != 1
+        || SSL_CTX_check_private_key(ctx) != 1) {
+        log_ssl_err(fmt::format("cannot load private key {}", config.tls_key));
+        reset();
+        return;
+    }
+}
+
+Tls::~Tls() noexcept
+{
+    reset();
+}
+
+void Tls::reset() noexcept
+{
+    if (ctx) {
+        SSL_CTX_free(ctx);
+        ctx = nullptr;
+    }
+}
+
+bool Tls::is_ready() const noexcept
+{
+    return ctx;
+}
+
+TlsConn::~TlsConn() noexcept
+{
+    reset();
+}
+
+bool TlsConn::start(const Tls& tls, int fd) noexcept
+{
+    reset();
+
+    ERR_clear_error();
+    if (_ssl = SSL_new(tls.ctx); !_ssl || SSL_set_fd(_ssl, fd) != 1) {
+        log_ssl_err("cannot create connection");
+        reset();
+        return false;
+    }
+
+    SSL_set_accept_state(_ssl);
+    return true;
+}
+
+void TlsConn::reset() noexcept
+{
+    if (_ssl) {
+        // close_notify, if socket is blocked it is dropped
+        if (_done && !_failed) {
+            ERR_clear_error();
+            SSL_shutdown(_ssl);
+        }
+
+        SSL_free(_ssl);
+        _ssl = nullptr;
+    }
+
+    _done = false;
+    _failed = false;
+    _ktls_recv = false;
+    _ktls_send = false;
+    _want = TlsState::Done;
+    _out.clear();
+    _out_file = false;
+}
+
+bool TlsConn::is_active() const noexcept
+{
+    return _ssl;
+}
+
+bool TlsConn::in_handshake() const noexcept
+{
+    return _ssl && !_done;
+}
+
+bool TlsConn::user_recv() const noexcept
+{
+    return _ssl && !_ktls_recv;
+}
+
+bool TlsConn::user_send() const noexcept
+{
+    return _ssl && !_ktls_send;
+}
+
+TlsState TlsConn::handshake() noexcept
+{
+    ERR_clear_error();
+    if (int rc = SSL_do_handshake(_ssl); rc != 1) {
+        switch (SSL_get_error(_ssl, rc)) {
+            case SSL_ERROR_WANT_READ:
+                return TlsState::WantRead;
+            case SSL_ERROR_WANT_WRITE:
+                return TlsState::WantWrite;
+            default:
+                _failed = true;
+                return TlsState::Error;
+        }
+    }
+
+    _done = true;
+#ifdef BIO_get_ktls_send
+    _ktls_recv = BIO_get_ktls_recv(SSL_get_rbio(_ssl));
+    _ktls_send = BIO_get_ktls_send(SSL_get_wbio(_ssl));
+#endif
+
+    return TlsState::Done;
+}
+
+string_view TlsConn::alpn() const noexcept
+{
+    const unsigned char* data = nullptr;
+    unsigned size = 0;
+
+    if (_ssl)
+        SSL_get0_alpn_selected(_ssl, &data, &size);
+
+    return {(const char*)data, size};
+}
+
+ssize_t TlsConn::read(char* data, size_t size) noexcept
+{
+    ERR_clear_error();
+    if (size_t count = 0; SSL_read_ex(_ssl, data, size, &count) == 1)
+        return count;
+
+    return fail();
+}
+
+ssize_t TlsConn::writev(const iovec* iov, uint32_t count) noexcept
+{
+    if (_out.empty()) {
+        try {
+            for (uint32_t i = 0; i < count && _out.size() < max_record; i++)
+                _out.append((const char*)iov[i].iov_base, std::min(iov[i].iov_len, max_record - _out.size()));
+        }
+        catch (...) {
+            _out.clear();
+            errno = ENOMEM;
+            return -1;
+        }
+
+        _out_file = false;
+    }
+    else if (_out_file) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return flush();
+}
+
+ssize_t TlsConn::sendfile(int fd, off_t* offset, size_t count) noexcept
+{
+    if (_out.empty()) {
+        try {
+            _out.resize(std::min(count, max_record));
+        }
+        catch (...) {
+            _out.clear();
+            errno = ENOMEM;
+            return -1;
+        }
+
+        auto size = pread(fd, _out.data(), _out.size(), *offset);
+        if (size <= 0) {
+            _out.clear();
+            return size;
+        }
+
+        _out.resize(size);
+        _out_file = true;
+    }
+    else if (!_out_file) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    auto size = flush();
+    if (size > 0)
+        *offset += size;
+
+    return size;
+}
+
+ssize_t TlsConn::flush() noexcept
+{
+    ERR_clear_error();
+    if (size_t count = 0; SSL_write_ex(_ssl, _out.data(), _out.size(), &count) == 1) {
+        _out.clear();
+        return count;
+    }
+
+    return fail();
+}
+
+TlsState TlsConn::want() const noexcept
+{
+    return _want;
+}
+
+ssize_t TlsConn::fail() noexcept
+{
+    switch (SSL_get_error(_ssl, 0)) {
+        case SSL_ERROR_WANT_READ:
+            _want = TlsState::WantRead;
+            errno = EAGAIN;
+            return -1;
+        case SSL_ERROR_WANT_WRITE:
+            _want = TlsState::WantWrite;
+            errno = EAGAIN;
+            return -1;
+        case SSL_ERROR_ZERO_RETURN:
+            // end of stream from peer, it does not wait for close_notify
+            _failed = true;
+            return 0;
+        case SSL_ERROR_SYSCALL:
+            _failed = true;
+            if (!errno)
+                errno = ECONNRESET;
+            return -1;
+        default:
+            _failed = true;
+            errno = EPROTO;
+            return -1;
+    }
+}
+
+#else
+
+Tls::Tls(const Config& config) noexcept
+{
+    log_err("[Tls] library is built without TLS support (SNIPER_TLS)");
+}
+
+Tls::~Tls() noexcept = default;
+
+void Tls::reset() noexcept {}
+
+bool Tls::is_ready() const noexcept
+{
+    return false;
+}
+
+TlsConn::~TlsConn() noexcept = default;
+
+bool TlsConn::start(const Tls& tls, int fd) noexcept
+{
+    return false;
+}
+
+void TlsConn::reset() noexcept {}
+
+bool TlsConn::is_active() const noexcept
+{
+    return false;
+}
+
+bool TlsConn::in_handshake() const noexcept
+{
+    return false;
+}
+
+bool TlsConn::user_recv() const noexcept
+{
+    return false;
+}
+
+bool TlsConn::user_send() const noexcept
+{
+    return false;
+}
+
+TlsState TlsConn::handshake() noexcept
+{
+    return TlsState::Error;
+}
+
+string_view TlsConn::alpn() const noexcept
+{
+    return {};
+}
+
+ssize_t TlsConn::read(char* data, size_t size) noexcept
+{
+    errno = ENOTSUP;
+    return -1;
+}
+
+ssize_t TlsConn::writev(const iovec* iov, uint32_t count) noexcept
+{
+    errno = ENOTSUP;
+    return -1;
+}
+
+ssize_t TlsConn::sendfile(int fd, off_t* offset, size_t count) noexcept
+{
+    errno = ENOTSUP;
+    return -1;
+}
+
+TlsState TlsConn::want() const noexcept
+{
+    return TlsState::Error;
+}
+
+ssize_t TlsConn::flush() noexcept
+{
+    return -1;
+}
+
+ssize_t TlsConn::fail() noexcept
+{
+    return -1;
+}
+
+#endif
+
+} // namespace sniper::http::server
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sniper/std/chrono.h>
+#include <sniper/std/string.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+// OpenSSL types, its headers are not exposed to server users
+typedef struct ssl_ctx_st SSL_CTX;
+typedef struct ssl_st SSL;
+
+namespace sniper::http::server {
+
+struct Config;
+
+// TLS context of server (OpenSSL, built with SNIPER_TLS). Session ticket keys are shared by the process and
+// rotated every ticket_lifetime: sessions resume on any loop of MultiServer.
+struct Tls final
+{
+    explicit Tls(const Config& config) noexcept;
+    ~Tls() noexcept;
+
+    [[nodiscard]] bool is_ready() const noexcept;
+
+    SSL_CTX* ctx = nullptr;
+    bool http2 = false; // h2 is offered by ALPN
+    milliseconds ticket_lifetime = 0ms;
+
+private:
+    void reset() noexcept;
+};
+
+enum class TlsState
+{
+    Done,
+    WantRead,
+    WantWrite,
+    Error
+};
+
+// TLS of connection, handshake is driven by connection watchers. I/O methods follow read/writev/sendfile:
+// -1 with errno EAGAIN when blocked, so callers keep their syscall loops. Record layer may need the other
+// direction (read wants to write and vice versa): want() tells which socket readiness to wait for.
+// If kernel and OpenSSL support kTLS, record layer moves to kernel after the handshake: user_recv/user_send
+// become false and plain syscalls on socket are used, writev and sendfile stay zero-copy.
+struct TlsConn final
+{
+    ~TlsConn() noexcept;
+
+    [[nodiscard]] bool start(const Tls& tls, int fd) noexcept;
+    void reset() noexcept;
+
+    [[nodiscard]] bool is_active() const noexcept;
+    [[nodiscard]] bool in_handshake() const noexcept;
+    [[nodiscard]] TlsState handshake() noexcept;
+    // protocol selected by ALPN, empty if none
+    [[nodiscard]] string_view alpn() const noexcept;
+
+    // data goes through OpenSSL
+    [[nodiscard]] bool user_recv() const noexcept;
+    [[nodiscard]] bool user_send() const noexcept;
+
+    [[nodiscard]] ssize_t read(char* data, size_t size) noexcept;
+    // Up to one record of data is copied from iov. If it is blocked, next call sends it again: the caller
+    // passes the same data at the head of iov (or the same file offset), as after EAGAIN from a syscall.
+    [[nodiscard]] ssize_t writev(const iovec* iov, uint32_t count) noexcept;
+    [[nodiscard]] ssize_t sendfile(int fd, off_t* offset, size_t count) noexcept;
+    // WantRead or WantWrite after EAGAIN from the last I/O call
+    [[nodiscard]] TlsState want() const noexcept;
+
+private:
+    [[nodiscard]] ssize_t flush() noexcept;
+    [[nodiscard]] ssize_t fail() noexcept;
+
+    SSL* _ssl = nullptr;
+    bool _done = false;
+    bool _failed = false; // no close_notify on reset
+    bool _ktls_recv = false;
+    bool _ktls_send = false;
+    TlsState _want = TlsState::Done;
+
+    string _out; // pending record
+    bool _out_file = false;
+};
+
+} // namespace sniper::http::server
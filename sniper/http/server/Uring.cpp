@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sniper/http/Buffer.h>
+#include <sniper/log/log.h>
+#include "Uring.h"
+#include "Config.h"
+
+namespace sniper::http::server {
+
+Uring::Uring(event::loop_ptr loop, const Config& config) : ring(std::move(loop), config.io_uring_entries)
+{
+    if (!ring.is_ready())
+        return;
+
+    if (!ring.setup_buf_ring(config.io_uring_buffers)) {
+        log_warn("[Uring] cannot setup {} provided buffers", config.io_uring_buffers);
+        ring.close(0ms);
+        return;
+    }
+
+    _bufs.reserve(config.io_uring_buffers);
+    for (uint32_t i = 0; i < config.io_uring_buffers; i++) {
+        auto buf = make_buffer(config.buffer_size);
+        if (!buf) {
+            log_err("[Uring] cannot allocate provided buffer");
+            close();
+            return;
+        }
+
+        ring.add_buf(buf->data(), buf->capacity(), i);
+        _bufs.emplace_back(std::move(buf));
+    }
+
+    ring.commit_bufs();
+}
+
+Uring::~Uring() noexcept
+{
+    close();
+}
+
+bool Uring::is_ready() const noexcept
+{
+    return ring.is_ready() && !_bufs.empty();
+}
+
+string_view Uring::get(uint16_t bid, int size) noexcept
+{
+    if (bid < _bufs.size() && size > 0)
+        return string_view(_bufs[bid]->data(), std::min((size_t)size, _bufs[bid]->capacity()));
+
+    return {};
+}
+
+void Uring::recycle(uint16_t bid) noexcept
+{
+    if (bid < _bufs.size() && ring.is_ready()) {
+        ring.add_buf(_bufs[bid]->data(), _bufs[bid]->capacity(), bid);
+        ring.commit_bufs();
+    }
+}
+
+void Uring::close() noexcept
+{
+    // buffers are released after kernel has finished with them
+    ring.close();
+    _bufs.clear();
+}
+
+} // namespace sniper::http::server
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sniper/event/Uring.h>
+#include <sniper/std/memory.h>
+#include <sniper/std/string.h>
+#include <sniper/std/vector.h>
+
+namespace sniper::http {
+
+struct Buffer;
+
+} // namespace sniper::http
+
+namespace sniper::http::server {
+
+struct Config;
+
+// io_uring instance of server with ring of provided receive buffers.
+// Buffers are taken from http::Buffer pool, data from them is copied to connection buffer
+// and slot is returned to kernel right away.
+struct Uring final
+{
+    Uring(event::loop_ptr loop, const Config& config);
+    ~Uring() noexcept;
+
+    [[nodiscard]] bool is_ready() const noexcept;
+
+    // data received into provided buffer bid
+    [[nodiscard]] string_view get(uint16_t bid, int size) noexcept;
+    // return buffer to kernel
+    void recycle(uint16_t bid) noexcept;
+    void close() noexcept;
+
+    event::Uring ring;
+
+private:
+    vector<intrusive_ptr<Buffer>> _bufs;
+};
+
+} // namespace sniper::http::server
@@ -74,7 +74,9 @@ bool set_reuse_addr_and_port(int fd)
     int enable = 1;
 
 #ifdef _GNU_SOURCE
-    return setsockopt(fd, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT, &enable, sizeof(enable)) == 0;
+    // option names are not flags: each one has to be set separately
+    return setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) == 0
+           && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) == 0;
 #else
     return setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) == 0;
 #endif
@@ -275,14 +277,14 @@ int accept4(int server_fd, uint32_t& ip, uint16_t& port)
     if (!set_non_blocking(fd))
         return -1;
 #else
-    sockaddr_in servaddr{};
+    sockaddr_storage servaddr{};
     memset(&servaddr, 0, sizeof(servaddr));
 
     socklen_t sa_len = sizeof(servaddr);
     int fd = ::accept4(server_fd, (sockaddr*)&servaddr, &sa_len, SOCK_NONBLOCK);
-    if (fd >= 0) {
-        ip = servaddr.sin_addr.s_addr;
-        port = ntohs(servaddr.sin_port);
+    if (fd >= 0 && servaddr.ss_family == AF_INET) {
+        ip = ((const sockaddr_in*)&servaddr)->sin_addr.s_addr;
+        port = ntohs(((const sockaddr_in*)&servaddr)->sin_port);
     }
 #endif
 
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <sniper/std/string.h>
+#include <strings.h>
+
+namespace sniper::pico {
+
+// Headers classified by parser, value is available by index without scanning all headers
+enum class KnownHeader : uint8_t
+{
+    Host,
+    Connection,
+    ContentLength,
+    ContentType,
+    ContentEncoding,
+    TransferEncoding,
+    UserAgent,
+    Accept,
+    AcceptEncoding,
+    AcceptLanguage,
+    Cookie,
+    Referer,
+    Origin,
+    Authorization,
+    XForwardedFor,
+    XForwardedProto,
+    XRealIp,
+    XRequestId,
+    CacheControl,
+    IfModifiedSince,
+    IfNoneMatch,
+    Range,
+    Expect,
+    Upgrade,
+    Forwarded,
+    Pragma,
+    Dnt,
+    Te,
+    Unknown
+};
+
+inline constexpr size_t KNOWN_HEADERS = static_cast<size_t>(KnownHeader::Unknown);
+
+namespace detail {
+
+// same order as KnownHeader
+inline constexpr string_view known_header_names[KNOWN_HEADERS] = {
+    "host",          "connection",      "content-length",  "content-type",    "content-encoding",  "transfer-encoding",
+    "user-agent",    "accept",          "accept-encoding", "accept-language", "cookie",            "referer",
+    "origin",        "authorization",   "x-forwarded-for", "x-forwarded-proto", "x-real-ip",       "x-request-id",
+    "cache-control", "if-modified-since", "if-none-match", "range",           "expect",            "upgrade",
+    "forwarded",     "pragma",          "dnt",             "te"};
+
+// perfect hash of names above: length, first and last char in lower case
+inline constexpr size_t known_header_slots = 64;
+
+constexpr size_t known_header_hash(size_t size, char first, char last) noexcept
+{
+    return (size + 6 * static_cast<uint8_t>(first | 0x20) + 16 * static_cast<uint8_t>(last | 0x20))
+           & (known_header_slots - 1);
+}
+
+struct KnownHeaderTable
+{
+    KnownHeader slots[known_header_slots]{};
+    bool perfect = true;
+};
+
+constexpr KnownHeaderTable make_known_header_table() noexcept
+{
+    KnownHeaderTable t;
+    for (auto& s : t.slots)
+        s = KnownHeader::Unknown;
+
+    for (size_t i = 0; i < KNOWN_HEADERS; i++) {
+        auto name = known_header_names[i];
+        auto& s = t.slots[known_header_hash(name.size(), name.front(), name.back())];
+
+        t.perfect = t.perfect && s == KnownHeader::Unknown;
+        s = static_cast<KnownHeader>(i);
+    }
+
+    return t;
+}
+
+inline constexpr KnownHeaderTable known_header_table = make_known_header_table();
+static_assert(known_header_table.perfect, "known header names collide, change known_header_hash");
+
+} // namespace detail
+
+// case-insensitive
+[[nodiscard]] inline KnownHeader known_header(string_view name) noexcept
+{
+    if (name.empty())
+        return KnownHeader::Unknown;
+
+    auto h = detail::known_header_table.slots[detail::known_header_hash(name.size(), name.front(), name.back())];
+    if (h == KnownHeader::Unknown)
+        return h;
+
+    auto known = detail::known_header_names[static_cast<size_t>(h)];
+    if (known.size() == name.size() && strncasecmp(known.data(), name.data(), name.size()) == 0)
+        return h;
+
+    return KnownHeader::Unknown;
+}
+
+[[nodiscard]] inline string_view known_header_name(KnownHeader h) noexcept
+{
+    return h < KnownHeader::Unknown ? detail::known_header_names[static_cast<size_t>(h)] : string_view{};
+}
+
+} // namespace sniper::pico
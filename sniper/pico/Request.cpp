@@ -21,16 +21,22 @@
 #include <sniper/pico/picohttpparser.h>
 #include <sniper/strings/ascii_case.h>
 #include <sniper/strings/atoi.h>
+#include <sniper/strings/url.h>
 #include "Request.h"
 
 namespace sniper::pico {
 
 namespace {
 
-const string_view header_content_length = "content-length";
-const string_view header_connection = "connection";
 const string_view header_connection_keep_alive = "keep-alive";
 const string_view header_connection_close = "close";
+const string_view header_transfer_encoding_chunked = "chunked";
+
+inline void rebase_sv(string_view& sv, const char* old_base, const char* new_base) noexcept
+{
+    if (!sv.empty())
+        sv = string_view(new_base + (sv.data() - old_base), sv.size());
+}
 
 pair_sv parse_param(string_view param)
 {
@@ -40,24 +46,14 @@ pair_sv parse_param(string_view param)
     return make_pair(param, "");
 }
 
-small_vector<pair_sv, MAX_PARAMS> parse_qs(string_view qs)
+// FNV-1a
+inline uint32_t key_hash(string_view key) noexcept
 {
-    small_vector<pair_sv, MAX_PARAMS> out;
-
-    while (!qs.empty()) {
-        if (size_t pos = qs.find_first_of("&"); pos != string_view::npos) {
-            if (pos)
-                out.emplace_back(parse_param(qs.substr(0, pos)));
-
-            qs.remove_prefix(pos + 1);
-        }
-        else {
-            out.emplace_back(parse_param(qs));
-            break;
-        }
-    }
+    uint32_t h = 2166136261u;
+    for (char c : key)
+        h = (h ^ static_cast<uint8_t>(c)) * 16777619u;
 
-    return out;
+    return h;
 }
 
 } // namespace
@@ -65,16 +61,33 @@ small_vector<pair_sv, MAX_PARAMS> parse_qs(string_view qs)
 void Request::clear() noexcept
 {
     head_parsed = false;
+    last_len = 0;
     header_size = 0;
     content_length = 0;
     keep_alive = false;
+    chunked = false;
+    decoded = 0;
+    trimmed = 0;
+    decoder = {};
     minor_version = 0;
     method = {};
     path = {};
     qs = {};
     fragment = {};
     headers.clear();
+    known.fill(0);
     params.clear();
+    params_parsed = false;
+    scratch.clear();
+}
+
+string_view Request::header(KnownHeader h) const noexcept
+{
+    if (h < KnownHeader::Unknown)
+        if (auto idx = known[static_cast<size_t>(h)]; idx)
+            return headers[idx - 1].second;
+
+    return {};
 }
 
 ParseResult Request::parse(string_view buf, size_t max_size, bool normalize, bool normalize_other) noexcept
@@ -87,18 +100,175 @@ ParseResult Request::parse(string_view buf, size_t max_size, bool normalize, boo
             return rc;
         }
 
-        if (max_size && (header_size + content_length) > max_size)
-            return ParseResult::Err;
-
         head_parsed = true;
     }
 
+    if (max_size && (header_size + content_length) > max_size)
+        return ParseResult::Err;
+
+    if (chunked)
+        return parse_chunked(buf, max_size);
+
     if (buf.size() >= header_size + content_length)
         return ParseResult::Complete;
 
     return ParseResult::Partial;
 }
 
+ParseResult Request::parse_chunked(string_view buf, size_t max_size) noexcept
+{
+    trimmed = 0;
+
+    // decoded data is right after headers, everything after it was not seen by decoder yet
+    if (buf.size() < header_size + decoded)
+        return ParseResult::Err;
+
+    auto* raw = const_cast<char*>(buf.data()) + header_size + decoded;
+    size_t raw_size = buf.size() - header_size - decoded;
+    size_t size = raw_size;
+
+    ssize_t rc = phr_decode_chunked(&decoder, raw, &size);
+    if (rc == -1)
+        return ParseResult::Err;
+
+    decoded += size;
+    trimmed = raw_size - size - (rc > 0 ? rc : 0);
+
+    if (max_size && header_size + decoded > max_size)
+        return ParseResult::Err;
+
+    if (rc == -2)
+        return ParseResult::Partial;
+
+    content_length = decoded;
+    return ParseResult::Complete;
+}
+
+void Request::rebase(const char* old_base, const char* new_base) noexcept
+{
+    if (old_base == new_base)
+        return;
+
+    rebase_sv(method, old_base, new_base);
+    rebase_sv(path, old_base, new_base);
+    rebase_sv(qs, old_base, new_base);
+    rebase_sv(fragment, old_base, new_base);
+
+    for (auto& [key, val] : headers) {
+        rebase_sv(key, old_base, new_base);
+        rebase_sv(val, old_base, new_base);
+    }
+
+    // some params point to scratch: parse again on next access
+    params.clear();
+    params_parsed = false;
+    scratch.clear();
+}
+
+void Request::set_path(string_view target) noexcept
+{
+    path = target;
+
+    // fragment
+    if (auto pos = path.find_first_of('#'); pos != string_view::npos) {
+        if (pos + 1 != path.size())
+            fragment = path.substr(pos + 1);
+
+        path.remove_suffix(path.size() - pos);
+    }
+
+    // qs
+    if (auto pos = path.find_first_of('?'); pos != string_view::npos) {
+        if (pos + 1 != path.size())
+            qs = path.substr(pos + 1);
+
+        path.remove_suffix(path.size() - pos);
+    }
+}
+
+const small_vector<pair_sv, MAX_PARAMS>& Request::get_params() noexcept
+{
+    if (!params_parsed)
+        parse_params();
+
+    return params;
+}
+
+string_view Request::param(string_view key) noexcept
+{
+    if (!params_parsed)
+        parse_params();
+
+    if (params.empty())
+        return {};
+
+    for (size_t i = key_hash(key);; i++) {
+        auto idx = params_index[i % params_slots];
+        if (!idx)
+            return {};
+
+        if (params[idx - 1].first == key)
+            return params[idx - 1].second;
+    }
+}
+
+void Request::parse_params() noexcept
+{
+    params_parsed = true;
+    params.clear();
+    params_index.fill(0);
+
+    // decoded data is not longer than source: scratch is not reallocated and views stay valid
+    scratch.clear();
+    try {
+        if (strings::is_url_encoded(qs))
+            scratch.reserve(qs.size());
+    }
+    catch (...) {
+        // OOM guard
+        return;
+    }
+
+    for (string_view rest = qs; !rest.empty() && params.size() < MAX_PARAMS;) {
+        auto pos = rest.find('&');
+        if (auto p = rest.substr(0, pos); !p.empty()) {
+            auto [key, val] = parse_param(p);
+            params.emplace_back(decode(key), decode(val));
+
+            // first param with this key is found by index
+            for (size_t i = key_hash(params.back().first);; i++) {
+                auto& idx = params_index[i % params_slots];
+                if (!idx) {
+                    idx = params.size();
+                    break;
+                }
+
+                if (params[idx - 1].first == params.back().first)
+                    break;
+            }
+        }
+
+        if (pos == string_view::npos)
+            break;
+
+        rest.remove_prefix(pos + 1);
+    }
+}
+
+string_view Request::decode(string_view str) noexcept
+{
+    if (!strings::is_url_encoded(str))
+        return str;
+
+    size_t offset = scratch.size();
+    scratch.resize(offset + str.size());
+
+    size_t size = strings::url_decode(str, scratch.data() + offset);
+    scratch.resize(offset + size);
+
+    return {scratch.data() + offset, size};
+}
+
 ParseResult Request::parse_head(string_view buf, bool normalize, bool normalize_other) noexcept
 {
     if (buf.empty())
@@ -120,7 +290,7 @@ ParseResult Request::parse_head(string_view buf, bool normalize, bool normalize_
     int pico_minor_version = -1;
 
     int ssize = phr_parse_request(buf.data(), buf.size(), &pico_method, &pico_method_len, &pico_path, &pico_path_len,
-                                  &pico_minor_version, pico_headers, &num_headers, 0);
+                                  &pico_minor_version, pico_headers, &num_headers, last_len);
 
     if (ssize > 0) {
         header_size = ssize;
@@ -137,27 +307,7 @@ ParseResult Request::parse_head(string_view buf, bool normalize, bool normalize_
         if (pico_path && pico_path_len) {
             if (normalize_other)
                 strings::to_lower_ascii(const_cast<char*>(pico_path), pico_path_len);
-            path = string_view(pico_path, pico_path_len);
-
-            // fragment
-            if (auto pos = path.find_first_of('#'); pos != string_view::npos) {
-                if (pos + 1 != path.size())
-                    fragment = path.substr(pos + 1);
-
-                path.remove_suffix(path.size() - pos);
-            }
-
-            // qs
-            if (auto pos = path.find_first_of('?'); pos != string_view::npos) {
-                if (pos + 1 != path.size())
-                    qs = path.substr(pos + 1);
-
-                path.remove_suffix(path.size() - pos);
-            }
-
-            // params
-            if (!qs.empty())
-                params = parse_qs(qs);
+            set_path(string_view(pico_path, pico_path_len));
         }
         else {
             path = "/";
@@ -168,6 +318,7 @@ ParseResult Request::parse_head(string_view buf, bool normalize, bool normalize_
 
         bool content_length_found = false;
         bool connection_found = false;
+        bool transfer_encoding_found = false;
 
         for (unsigned i = 0; i < num_headers; i++) {
             if (normalize)
@@ -178,31 +329,57 @@ ParseResult Request::parse_head(string_view buf, bool normalize, bool normalize_
             string_view key(pico_headers[i].name, pico_headers[i].name_len);
             string_view val(pico_headers[i].value, pico_headers[i].value_len);
 
-            // content-length
-            if (!content_length_found && strings::iequals(key, header_content_length)) {
-                content_length_found = true;
-                if (auto len = strings::fast_atoi64(val); len)
-                    content_length = *len;
-                else
-                    return ParseResult::Err;
-            }
+            auto h = known_header(key);
+            if (h != KnownHeader::Unknown && !known[static_cast<size_t>(h)])
+                known[static_cast<size_t>(h)] = headers.size() + 1;
 
-            // connection
-            if (!connection_found && strings::iequals(key, header_connection)) {
-                connection_found = true;
+            headers.emplace_back(key, val);
 
-                if (minor_version == 0 && strings::iequals(val, header_connection_keep_alive))
-                    keep_alive = true;
-                else if (minor_version == 1 && strings::iequals(val, header_connection_close))
-                    keep_alive = false;
+            switch (h) {
+                case KnownHeader::ContentLength:
+                    // repeated header must have the same value
+                    if (auto len = strings::fast_atoi64(val);
+                        len && (!content_length_found || static_cast<size_t>(*len) == content_length))
+                        content_length = *len;
+                    else
+                        return ParseResult::Err;
+
+                    content_length_found = true;
+                    break;
+                case KnownHeader::Connection:
+                    if (!connection_found) {
+                        connection_found = true;
+
+                        if (minor_version == 0 && strings::iequals(val, header_connection_keep_alive))
+                            keep_alive = true;
+                        else if (minor_version == 1 && strings::iequals(val, header_connection_close))
+                            keep_alive = false;
+                    }
+                    break;
+                case KnownHeader::TransferEncoding:
+                    // only single chunked is supported
+                    if (transfer_encoding_found || val.size() != header_transfer_encoding_chunked.size()
+                        || !strings::iequals(val, header_transfer_encoding_chunked))
+                        return ParseResult::Err;
+
+                    transfer_encoding_found = true;
+                    chunked = true;
+                    decoder.consume_trailer = 1;
+                    break;
+                default:
+                    break;
             }
-
-            headers.emplace_back(key, val);
         }
 
+        // request smuggling guard
+        if (chunked && content_length_found)
+            return ParseResult::Err;
+
         return ParseResult::Complete;
     }
     else if (ssize == -2) {
+        // next call checks only new bytes for the end of head
+        last_len = buf.size();
         return ParseResult::Partial;
     }
     else {
@@ -17,7 +17,10 @@
 
 #pragma once
 
+#include <array>
+#include <sniper/pico/Header.h>
 #include <sniper/pico/common.h>
+#include <sniper/pico/picohttpparser.h>
 #include <sniper/std/boost_vector.h>
 
 namespace sniper::pico {
@@ -27,12 +30,33 @@ struct Request final
     void clear() noexcept;
     [[nodiscard]] ParseResult parse(string_view buf, size_t max_size, bool normalize, bool normalize_vals) noexcept;
     [[nodiscard]] ParseResult parse_head(string_view buf, bool normalize, bool normalize_vals) noexcept;
+    // buffer with partially parsed request was moved
+    void rebase(const char* old_base, const char* new_base) noexcept;
+    // value of the first header with this name, empty if not found
+    [[nodiscard]] string_view header(KnownHeader h) const noexcept;
+    // request target: path, query string and fragment
+    void set_path(string_view target) noexcept;
+
+    // Query params are parsed and percent-decoded on first call. Values without escapes point to request buffer,
+    // decoded ones - to scratch of this object.
+    [[nodiscard]] const small_vector<pair_sv, MAX_PARAMS>& get_params() noexcept;
+    // value of the first param with this key, empty if not found
+    [[nodiscard]] string_view param(string_view key) noexcept;
 
     bool head_parsed = false;
+    size_t last_len = 0; // head bytes already checked by previous partial parse
     size_t header_size = 0;
     size_t content_length = 0;
     bool keep_alive = false;
 
+    // Transfer-Encoding: chunked. Body is decoded in place right after headers, content_length is set
+    // when the last chunk is received. trimmed - number of bytes removed from the end of the buffer
+    // by the last parse call, caller must shrink its buffer by this value.
+    bool chunked = false;
+    size_t decoded = 0;
+    size_t trimmed = 0;
+    phr_chunked_decoder decoder{};
+
     int minor_version = 0;
     string_view method;
     string_view path;
@@ -40,7 +64,19 @@ struct Request final
     string_view fragment;
 
     static_vector<pair_sv, MAX_HEADERS> headers;
+    std::array<uint8_t, KNOWN_HEADERS> known{}; // index in headers + 1, 0 - not found
     small_vector<pair_sv, MAX_PARAMS> params;
+
+private:
+    static constexpr size_t params_slots = 2 * MAX_PARAMS;
+
+    void parse_params() noexcept;
+    [[nodiscard]] string_view decode(string_view str) noexcept;
+
+    bool params_parsed = false;
+    string scratch;
+    std::array<uint8_t, params_slots> params_index{}; // open addressing by key hash: index in params + 1
+    [[nodiscard]] ParseResult parse_chunked(string_view buf, size_t max_size) noexcept;
 };
 
 } // namespace sniper::pico
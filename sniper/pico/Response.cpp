@@ -27,6 +27,7 @@ namespace sniper::pico {
 void Response::clear() noexcept
 {
     status = -1;
+    last_len = 0;
     header_size = 0;
     content_length = 0;
     keep_alive = false;
@@ -49,7 +50,7 @@ ParseResult Response::parse(char* data, size_t size) noexcept
     const char* msg = nullptr;
     size_t msg_len = 0;
     int ssize =
-        phr_parse_response(data, size, &pico_minor_version, &status, &msg, &msg_len, pico_headers, &num_headers, 0);
+        phr_parse_response(data, size, &pico_minor_version, &status, &msg, &msg_len, pico_headers, &num_headers, last_len);
 
     if (ssize > 0) {
         header_size = ssize;
@@ -92,6 +93,8 @@ ParseResult Response::parse(char* data, size_t size) noexcept
         return ParseResult::Complete;
     }
     else if (ssize == -2) {
+        // next call checks only new bytes for the end of head
+        last_len = size;
         return ParseResult::Partial;
     }
     else {
@@ -26,6 +26,7 @@ struct Response final
     void clear() noexcept;
     [[nodiscard]] ParseResult parse(char* data, size_t size) noexcept;
 
+    size_t last_len = 0; // head bytes already checked by previous partial parse
     size_t header_size = 0;
     size_t content_length = 0;
     bool keep_alive = false;
@@ -0,0 +1,156 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+/*
+ * Copyright (c) 2018 - 2020, MetaHash, RTBtech, MediaSniper,
+ * Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Request head parser throughput for every SIMD level supported by the CPU.
+// Usage: sniper_pico_bench [corpus] [iterations]
+// Corpus: request heads with LF line endings, each one terminated by an empty line.
+
+#include <cstdlib>
+#include <fmt/format.h>
+#include <fstream>
+#include <sniper/pico/picohttpparser.h>
+#include <sniper/std/array.h>
+#include <sniper/std/chrono.h>
+#include <sniper/std/string.h>
+#include <sniper/std/vector.h>
+#include <sstream>
+
+using namespace sniper;
+
+namespace {
+
+constexpr size_t max_headers = 64;
+
+struct Parsed final
+{
+    int ret = 0;
+    size_t method_len = 0;
+    size_t path_len = 0;
+    int minor_version = 0;
+    size_t num_headers = 0;
+    array<phr_header, max_headers> headers{};
+};
+
+vector<string> load(const char* path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return {};
+
+    vector<string> out;
+    string head;
+    string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        head += line;
+        head += "\r\n";
+        if (line.empty()) {
+            if (head.size() > 2)
+                out.emplace_back(std::move(head));
+            head.clear();
+        }
+    }
+
+    return out;
+}
+
+bool parse(const string& buf, Parsed& p) noexcept
+{
+    const char* method = nullptr;
+    const char* path = nullptr;
+    p.num_headers = max_headers;
+    p.ret = phr_parse_request(buf.data(), buf.size(), &method, &p.method_len, &path, &p.path_len, &p.minor_version,
+                              p.headers.data(), &p.num_headers, 0);
+    return p.ret == (int)buf.size();
+}
+
+// every level must split the corpus exactly like the scalar parser
+bool same(const Parsed& a, const Parsed& b) noexcept
+{
+    if (a.ret != b.ret || a.method_len != b.method_len || a.path_len != b.path_len
+        || a.minor_version != b.minor_version || a.num_headers != b.num_headers)
+        return false;
+
+    for (size_t i = 0; i < a.num_headers; i++) {
+        auto& x = a.headers[i];
+        auto& y = b.headers[i];
+        if (x.name != y.name || x.name_len != y.name_len || x.value != y.value || x.value_len != y.value_len)
+            return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const char* path = argc > 1 ? argv[1] : SNIPER_BENCH_CORPUS;
+    size_t iterations = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200000;
+
+    auto corpus = load(path);
+    if (corpus.empty()) {
+        fmt::print(stderr, "cannot load corpus from {}\n", path);
+        return 1;
+    }
+
+    size_t bytes = 0;
+    vector<Parsed> reference(corpus.size());
+    phr_set_simd_level(PHR_SIMD_SCALAR);
+    for (size_t i = 0; i < corpus.size(); i++) {
+        if (!parse(corpus[i], reference[i])) {
+            fmt::print(stderr, "corpus request {} is not a complete request head\n", i);
+            return 1;
+        }
+        bytes += corpus[i].size();
+    }
+
+    fmt::print("{} requests, {} bytes, {} iterations\n", corpus.size(), bytes, iterations);
+
+    static constexpr array<const char*, 4> names = {"scalar", "sse4.2", "avx2", "avx512"};
+    int rc = 0;
+    for (int level = PHR_SIMD_SCALAR; level <= PHR_SIMD_AVX512; level++) {
+        if (phr_set_simd_level(level) != level)
+            continue;
+
+        Parsed p;
+        for (size_t i = 0; i < corpus.size(); i++) {
+            if (!parse(corpus[i], p) || !same(p, reference[i])) {
+                fmt::print(stderr, "{}: request {} differs from scalar parser\n", names[level], i);
+                rc = 1;
+            }
+        }
+
+        size_t ok = 0;
+        auto start = steady_clock::now();
+        for (size_t n = 0; n < iterations; n++)
+            for (auto& buf : corpus)
+                ok += parse(buf, p);
+        auto ns = duration_cast<std::chrono::nanoseconds>(steady_clock::now() - start).count();
+
+        double total = (double)iterations * corpus.size();
+        fmt::print("{:>8}: {:8.1f} ns/request {:8.1f} MB/s{}\n", names[level], ns / total,
+                   (double)bytes * iterations * 1000.0 / ns, ok == total ? "" : " (parse errors)");
+    }
+
+    return rc;
+}
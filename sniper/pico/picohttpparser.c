@@ -27,7 +27,13 @@
 #include <assert.h>
 #include <stddef.h>
 #include <string.h>
-#ifdef __SSE4_2__
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+/* scanners for every supported instruction set are compiled in and picked at load time */
+#define PHR_SIMD_DISPATCH 1
+#define PHR_TARGET(t) __attribute__((target(t)))
+#include <immintrin.h>
+#elif defined(__SSE4_2__)
+#define PHR_TARGET(t)
 #ifdef _MSC_VER
 #include <nmmintrin.h>
 #else
@@ -104,10 +110,27 @@ static const char *token_char_map = "\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\
                                     "\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0"
                                     "\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0";
 
-static const char *findchar_fast(const char *buf, const char *buf_end, const char *ranges, size_t ranges_size, int *found)
+/* Scanners below return the first char of buf falling into one of ranges (pairs of inclusive bounds, at most 8 pairs)
+ * and set *found. When nothing is found they may stop before buf_end, the caller checks the rest byte by byte. */
+typedef const char *(*findchar_fn)(const char *buf, const char *buf_end, const char *ranges, size_t ranges_size, int *found);
+
+#if defined(PHR_SIMD_DISPATCH) || !defined(__SSE4_2__)
+static const char *findchar_scalar(const char *buf, const char *buf_end, const char *ranges, size_t ranges_size, int *found)
+{
+    *found = 0;
+    /* suppress unused parameter warning */
+    (void)buf_end;
+    (void)ranges;
+    (void)ranges_size;
+    return buf;
+}
+#endif
+
+#if defined(PHR_SIMD_DISPATCH) || defined(__SSE4_2__)
+PHR_TARGET("sse4.2")
+static const char *findchar_sse42(const char *buf, const char *buf_end, const char *ranges, size_t ranges_size, int *found)
 {
     *found = 0;
-#if __SSE4_2__
     if (likely(buf_end - buf >= 16)) {
         __m128i ranges16 = _mm_loadu_si128((const __m128i *)ranges);
 
@@ -124,33 +147,169 @@ static const char *findchar_fast(const char *buf, const char *buf_end, const cha
             left -= 16;
         } while (likely(left != 0));
     }
+    return buf;
+}
+#endif
+
+#ifdef PHR_SIMD_DISPATCH
+/* unsigned lo <= b <= hi is max(b, lo) == b && min(b, hi) == b */
+PHR_TARGET("avx2,sse4.2") __attribute__((noinline))
+static const char *findchar_avx2_wide(const char *buf, const char *buf_end, const char *ranges, size_t ranges_size, int *found)
+{
+    size_t i, n = ranges_size / 2;
+    __m256i lo[8], hi[8];
+    for (i = 0; i != n; ++i) {
+        lo[i] = _mm256_set1_epi8(ranges[i * 2]);
+        hi[i] = _mm256_set1_epi8(ranges[i * 2 + 1]);
+    }
+    do {
+        __m256i b32 = _mm256_loadu_si256((const __m256i *)buf);
+        __m256i m = _mm256_setzero_si256();
+        for (i = 0; i != n; ++i) {
+            __m256i ge = _mm256_cmpeq_epi8(_mm256_max_epu8(b32, lo[i]), b32);
+            __m256i le = _mm256_cmpeq_epi8(_mm256_min_epu8(b32, hi[i]), b32);
+            m = _mm256_or_si256(m, _mm256_and_si256(ge, le));
+        }
+        unsigned mask = (unsigned)_mm256_movemask_epi8(m);
+        if (unlikely(mask != 0)) {
+            *found = 1;
+            return buf + __builtin_ctz(mask);
+        }
+        buf += 32;
+    } while (likely(buf_end - buf >= 32));
+    return findchar_sse42(buf, buf_end, ranges, ranges_size, found);
+}
+
+PHR_TARGET("avx512f,avx512bw,sse4.2") __attribute__((noinline))
+static const char *findchar_avx512_wide(const char *buf, const char *buf_end, const char *ranges, size_t ranges_size, int *found)
+{
+    size_t i, n = ranges_size / 2;
+    __m512i lo[8], hi[8];
+    for (i = 0; i != n; ++i) {
+        lo[i] = _mm512_set1_epi8(ranges[i * 2]);
+        hi[i] = _mm512_set1_epi8(ranges[i * 2 + 1]);
+    }
+    do {
+        __m512i b64 = _mm512_loadu_si512((const void *)buf);
+        __mmask64 mask = 0;
+        for (i = 0; i != n; ++i)
+            mask |= _mm512_mask_cmple_epu8_mask(_mm512_cmpge_epu8_mask(b64, lo[i]), b64, hi[i]);
+        if (unlikely(mask != 0)) {
+            *found = 1;
+            return buf + __builtin_ctzll(mask);
+        }
+        buf += 64;
+    } while (likely(buf_end - buf >= 64));
+    return findchar_sse42(buf, buf_end, ranges, ranges_size, found);
+}
+
+/* buf_end is the end of the whole head while most names and values are short: the first bytes are probed with
+ * pcmpestri and only long runs (User-Agent, Cookie) pay for the wide setup */
+#define PROBE_SIZE 64
+
+PHR_TARGET("avx2,sse4.2")
+static const char *findchar_avx2(const char *buf, const char *buf_end, const char *ranges, size_t ranges_size, int *found)
+{
+    if (buf_end - buf <= PROBE_SIZE + 32)
+        return findchar_sse42(buf, buf_end, ranges, ranges_size, found);
+
+    buf = findchar_sse42(buf, buf + PROBE_SIZE, ranges, ranges_size, found);
+    if (*found)
+        return buf;
+    return findchar_avx2_wide(buf, buf_end, ranges, ranges_size, found);
+}
+
+PHR_TARGET("avx512f,avx512bw,sse4.2")
+static const char *findchar_avx512(const char *buf, const char *buf_end, const char *ranges, size_t ranges_size, int *found)
+{
+    if (buf_end - buf <= PROBE_SIZE + 64)
+        return findchar_sse42(buf, buf_end, ranges, ranges_size, found);
+
+    buf = findchar_sse42(buf, buf + PROBE_SIZE, ranges, ranges_size, found);
+    if (*found)
+        return buf;
+    return findchar_avx512_wide(buf, buf_end, ranges, ranges_size, found);
+}
+
+static findchar_fn findchar_impl = findchar_scalar;
+static int simd_level = PHR_SIMD_SCALAR;
+
+int phr_simd_level(void)
+{
+    return simd_level;
+}
+
+int phr_set_simd_level(int level)
+{
+    __builtin_cpu_init();
+    if (level >= PHR_SIMD_AVX512 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+        findchar_impl = findchar_avx512;
+        simd_level = PHR_SIMD_AVX512;
+    } else if (level >= PHR_SIMD_AVX2 && __builtin_cpu_supports("avx2")) {
+        findchar_impl = findchar_avx2;
+        simd_level = PHR_SIMD_AVX2;
+    } else if (level >= PHR_SIMD_SSE42 && __builtin_cpu_supports("sse4.2")) {
+        findchar_impl = findchar_sse42;
+        simd_level = PHR_SIMD_SSE42;
+    } else {
+        findchar_impl = findchar_scalar;
+        simd_level = PHR_SIMD_SCALAR;
+    }
+    return simd_level;
+}
+
+__attribute__((constructor)) static void phr_simd_init(void)
+{
+    phr_set_simd_level(PHR_SIMD_AVX512);
+}
+
+static inline const char *findchar_fast(const char *buf, const char *buf_end, const char *ranges, size_t ranges_size, int *found)
+{
+    return findchar_impl(buf, buf_end, ranges, ranges_size, found);
+}
 #else
-    /* suppress unused parameter warning */
-    (void)buf_end;
-    (void)ranges;
-    (void)ranges_size;
+int phr_simd_level(void)
+{
+#ifdef __SSE4_2__
+    return PHR_SIMD_SSE42;
+#else
+    return PHR_SIMD_SCALAR;
+#endif
+}
+
+int phr_set_simd_level(int level)
+{
+    (void)level;
+    return phr_simd_level();
+}
+
+static inline const char *findchar_fast(const char *buf, const char *buf_end, const char *ranges, size_t ranges_size, int *found)
+{
+#ifdef __SSE4_2__
+    return findchar_sse42(buf, buf_end, ranges, ranges_size, found);
+#else
+    return findchar_scalar(buf, buf_end, ranges, ranges_size, found);
 #endif
-    return buf;
 }
+#endif
 
 static const char *get_token_to_eol(const char *buf, const char *buf_end, const char **token, size_t *token_len, int *ret)
 {
     const char *token_start = buf;
 
-#ifdef __SSE4_2__
     // FIX - set size
-    static const char ranges1[16] = "\0\010"
-                                  /* allow HT */
-                                  "\012\037"
-                                  /* allow SP and up to but not including DEL */
-                                  "\177\177"
+    static const char ALIGNED(16) ranges1[16] = "\0\010"
+                                              /* allow HT */
+                                              "\012\037"
+                                              /* allow SP and up to but not including DEL */
+                                              "\177\177"
         /* allow chars w. MSB set */
         ;
     int found;
     buf = findchar_fast(buf, buf_end, ranges1, 6, &found); // FIX: change sizeof(ranges1)-1 to 6
     if (found)
         goto FOUND_CTL;
-#else
+
     /* find non-printable char within the next 8 bytes, this is the hottest code; manually inlined */
     while (likely(buf_end - buf >= 8)) {
 #define DOIT()                                                                                                                     \
@@ -175,7 +334,6 @@ static const char *get_token_to_eol(const char *buf, const char *buf_end, const
         }
         ++buf;
     }
-#endif
     for (;; ++buf) {
         CHECK_EOF();
         if (unlikely(!IS_PRINTABLE_ASCII(*buf))) {
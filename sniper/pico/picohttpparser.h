@@ -60,6 +60,15 @@ int phr_parse_response(const char *_buf, size_t len, int *minor_version, int *st
 /* ditto */
 int phr_parse_headers(const char *buf, size_t len, struct phr_header *headers, size_t *num_headers, size_t last_len);
 
+/* header scanner implementations, the best one supported by the CPU is selected at load time */
+enum { PHR_SIMD_SCALAR = 0, PHR_SIMD_SSE42, PHR_SIMD_AVX2, PHR_SIMD_AVX512 };
+
+/* returns the implementation in use */
+int phr_simd_level(void);
+
+/* selects the best supported implementation not above level and returns it, not thread safe against running parsers */
+int phr_set_simd_level(int level);
+
 /* should be zero-filled before start */
 struct phr_chunked_decoder {
     size_t bytes_left_in_chunk; /* number of bytes left in current chunk */
@@ -19,13 +19,14 @@
  * limitations under the License.
  */
 
+#include <cstring>
 #include "ascii_case.h"
+#include "simd.h"
 
 namespace sniper::strings {
 
 namespace {
 
-
 void toLowerAscii8(char& c) noexcept
 {
     // Branchless tolower, based on the input-rotating trick described
@@ -119,10 +120,131 @@ void toLowerAscii64(uint64_t& c) noexcept
     c += rotated;
 }
 
+inline char lower(char c) noexcept
+{
+    return char(c + (uint8_t(c - 'A') < 26 ? 0x20 : 0));
+}
+
+bool iequals_word(const char* a, const char* b) noexcept
+{
+    uint64_t wa, wb;
+    memcpy(&wa, a, sizeof(wa));
+    memcpy(&wb, b, sizeof(wb));
+    if (wa == wb)
+        return true;
+
+    toLowerAscii64(wa);
+    toLowerAscii64(wb);
+    return wa == wb;
+}
+
+bool iequals_scalar(const char* a, const char* b, size_t n) noexcept
+{
+    if (n < 8) {
+        for (size_t i = 0; i < n; i++)
+            if (a[i] != b[i] && lower(a[i]) != lower(b[i]))
+                return false;
+
+        return true;
+    }
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        if (!iequals_word(a + i, b + i))
+            return false;
+
+    return i == n || iequals_word(a + n - 8, b + n - 8);
+}
+
+#ifdef SNIPER_STRINGS_X86
+// Bytes above 0x7f are negative for the signed compare and never fall into 'A'-'Z'
+inline __m128i lower_sse2(__m128i c) noexcept
+{
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('A' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('Z' + 1), c));
+    return _mm_or_si128(c, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+SNIPER_TARGET("avx2") inline __m256i lower_avx2(__m256i c) noexcept
+{
+    __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('A' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), c));
+    return _mm256_or_si256(c, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
+
+// Lowercase whole blocks, return the number of converted bytes. An overlapping last block would load across the
+// previous store and miss store forwarding, so the tail is left to the word-at-a-time code.
+size_t to_lower_sse2(char* str, size_t length) noexcept
+{
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        auto* p = reinterpret_cast<__m128i*>(str + i);
+        _mm_storeu_si128(p, lower_sse2(_mm_loadu_si128(p)));
+    }
+    return i;
+}
+
+SNIPER_TARGET("avx2") size_t to_lower_avx2(char* str, size_t length) noexcept
+{
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        auto* p = reinterpret_cast<__m256i*>(str + i);
+        _mm256_storeu_si256(p, lower_avx2(_mm256_loadu_si256(p)));
+    }
+
+    if (i + 16 <= length) {
+        auto* p = reinterpret_cast<__m128i*>(str + i);
+        _mm_storeu_si128(p, _mm256_castsi256_si128(lower_avx2(_mm256_castsi128_si256(_mm_loadu_si128(p)))));
+        i += 16;
+    }
+    return i;
+}
+
+// Compare kernels take n >= vector size and finish with an overlapping last vector
+bool iequals_sse2(const char* a, const char* b, size_t n) noexcept
+{
+    auto eq = [a, b](size_t i) {
+        __m128i va = lower_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+        __m128i vb = lower_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) == 0xffff;
+    };
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+        if (!eq(i))
+            return false;
+
+    return i == n || eq(n - 16);
+}
+
+// return where the SSE2 tail starts, npos if whole 32 byte blocks differ
+SNIPER_TARGET("avx2") size_t iequals_avx2(const char* a, const char* b, size_t n) noexcept
+{
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i va = lower_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)));
+        __m256i vb = lower_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+        if (uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb))) != 0xffffffff)
+            return string_view::npos;
+    }
+
+    return i;
+}
+#endif
+
 } // namespace
 
 void to_lower_ascii(char* str, size_t length) noexcept
 {
+#ifdef SNIPER_STRINGS_X86
+    if (length >= 16 && simd::level() != simd::Level::Scalar) {
+        // split 32 byte loads cost more than they save on typical header lengths
+        size_t n = length >= 256 && simd::level() == simd::Level::AVX2 ? to_lower_avx2(str, length)
+                                                                      : to_lower_sse2(str, length);
+        str += n;
+        length -= n;
+    }
+#endif
+
     static const size_t kAlignMask64 = 7;
     static const size_t kAlignMask32 = 3;
 
@@ -169,6 +291,27 @@ void to_lower_ascii(char* str, size_t length) noexcept
     }
 }
 
+bool iequals(string_view a, string_view b) noexcept
+{
+    size_t n = std::min(a.size(), b.size());
+
+#ifdef SNIPER_STRINGS_X86
+    if (n >= 32 && simd::level() == simd::Level::AVX2) {
+        size_t i = iequals_avx2(a.data(), b.data(), n);
+        if (i == string_view::npos || i == n)
+            return i == n;
+
+        size_t back = n - i < 16 ? 16 - (n - i) : 0;
+        return iequals_sse2(a.data() + i - back, b.data() + i - back, std::max<size_t>(n - i, 16));
+    }
+
+    if (n >= 16 && simd::level() != simd::Level::Scalar)
+        return iequals_sse2(a.data(), b.data(), n);
+#endif
+
+    return iequals_scalar(a.data(), b.data(), n);
+}
+
 string to_lower_ascii_copy(string_view str)
 {
     string out(str);
@@ -19,7 +19,6 @@
 #pragma once
 
 #include <sniper/std/string.h>
-#include <strings.h>
 
 namespace sniper::strings {
 
@@ -33,9 +32,7 @@ inline void to_lower_ascii(string& str) noexcept
 
 string to_lower_ascii_copy(string_view str);
 
-inline bool iequals(string_view a, string_view b) noexcept
-{
-    return strncasecmp(a.data(), b.data(), std::min(a.size(), b.size())) == 0;
-}
+// ASCII case-insensitive compare of the common prefix: min(a.size(), b.size()) chars
+bool iequals(string_view a, string_view b) noexcept;
 
 } // namespace sniper::strings
@@ -0,0 +1,130 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstring>
+#include "find.h"
+#include "simd.h"
+
+namespace sniper::strings {
+
+namespace {
+
+constexpr size_t MAX_SIMD_CHARS = 16;
+
+size_t find_scalar(const char* str, size_t size, string_view chars) noexcept
+{
+    uint64_t set[4] = {0, 0, 0, 0};
+    for (unsigned char c : chars)
+        set[c >> 6u] |= uint64_t(1) << (c & 63u);
+
+    for (size_t i = 0; i < size; i++) {
+        auto c = static_cast<unsigned char>(str[i]);
+        if (set[c >> 6u] & (uint64_t(1) << (c & 63u)))
+            return i;
+    }
+
+    return string_view::npos;
+}
+
+#ifdef SNIPER_STRINGS_X86
+// Kernels take size >= vector size and finish with an overlapping last vector: no match found before it means any
+// match inside it is not earlier than the unscanned part.
+size_t find_sse2(const char* str, size_t size, const char* chars, size_t n) noexcept
+{
+    __m128i c[MAX_SIMD_CHARS];
+    for (size_t k = 0; k < n; k++)
+        c[k] = _mm_set1_epi8(chars[k]);
+
+    auto match = [&](size_t i) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+        __m128i m = _mm_cmpeq_epi8(v, c[0]);
+        for (size_t k = 1; k < n; k++)
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(v, c[k]));
+        return unsigned(_mm_movemask_epi8(m));
+    };
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+        if (unsigned m = match(i); m)
+            return i + __builtin_ctz(m);
+
+    if (i != size)
+        if (unsigned m = match(size - 16); m)
+            return size - 16 + __builtin_ctz(m);
+
+    return string_view::npos;
+}
+
+SNIPER_TARGET("avx2") size_t find_avx2(const char* str, size_t size, const char* chars, size_t n) noexcept
+{
+    __m256i c[MAX_SIMD_CHARS];
+    for (size_t k = 0; k < n; k++)
+        c[k] = _mm256_set1_epi8(chars[k]);
+
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + i));
+        __m256i m = _mm256_cmpeq_epi8(v, c[0]);
+        for (size_t k = 1; k < n; k++)
+            m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, c[k]));
+
+        if (uint32_t mask = uint32_t(_mm256_movemask_epi8(m)); mask)
+            return i + __builtin_ctz(mask);
+    }
+
+    if (i == size)
+        return string_view::npos;
+
+    size_t back = size - i < 16 ? 16 - (size - i) : 0;
+    size_t r = find_sse2(str + i - back, size - i + back, chars, n);
+    return r == string_view::npos ? r : i - back + r;
+}
+#endif
+
+} // namespace
+
+size_t find_first_of(string_view str, string_view chars, size_t pos) noexcept
+{
+    if (pos >= str.size() || chars.empty())
+        return string_view::npos;
+
+    const char* data = str.data() + pos;
+    size_t size = str.size() - pos;
+
+    if (chars.size() == 1) {
+        auto* p = static_cast<const char*>(memchr(data, chars.front(), size));
+        return p ? size_t(p - str.data()) : string_view::npos;
+    }
+
+    size_t r = string_view::npos;
+#ifdef SNIPER_STRINGS_X86
+    if (size >= 32 && chars.size() <= MAX_SIMD_CHARS && simd::level() == simd::Level::AVX2)
+        r = find_avx2(data, size, chars.data(), chars.size());
+    else if (size >= 16 && chars.size() <= MAX_SIMD_CHARS && simd::level() != simd::Level::Scalar)
+        r = find_sse2(data, size, chars.data(), chars.size());
+    else
+        r = find_scalar(data, size, chars);
+#else
+    r = find_scalar(data, size, chars);
+#endif
+
+    return r == string_view::npos ? r : pos + r;
+}
+
+} // namespace sniper::strings
@@ -18,6 +18,7 @@
  */
 
 #include "hex.h"
+#include "simd.h"
 
 namespace sniper::strings {
 
@@ -53,9 +54,7 @@ const unsigned char DecLookup[256] = {
     0,  0,  0,  0,  0,  0,  0, 0, 0, 0, 0, 0, 0, 0, 0, 0 // fill zeroes
 };
 
-} // namespace
-
-void bin2hex(const unsigned char* src, size_t len, char* dst) noexcept
+void bin2hex_scalar(const unsigned char* src, size_t len, char* dst) noexcept
 {
     for (size_t i = 0; i < len; i++) {
         const char* hex = HexLookup + 2 * src[i];
@@ -64,41 +63,191 @@ void bin2hex(const unsigned char* src, size_t len, char* dst) noexcept
     }
 }
 
-void bin2hex_append(const unsigned char* src, size_t len, string& dst) noexcept
+void hex2bin_scalar(const unsigned char* data, size_t len, unsigned char* dst) noexcept
 {
-    for (size_t i = 0; i < len; i++)
-        dst.append(HexLookup + *(src + i) * 2, 2);
+    for (size_t i = 0; i + 1 < len; i += 2)
+        dst[i / 2] = (DecLookup[data[i]] << 4u) | DecLookup[data[i + 1]];
+
+    // odd length: missing low nibble is zero
+    if (len & 1u)
+        dst[len / 2] = DecLookup[data[len - 1]] << 4u;
 }
 
-size_t hex2bin(const char* src, size_t len, unsigned char* dst) noexcept
+#ifdef SNIPER_STRINGS_X86
+// nibble n to '0'-'9' or 'a'-'f': '0' + n + (n > 9 ? 39 : 0)
+inline __m128i nibble2hex_sse2(__m128i n) noexcept
 {
-    auto* data = reinterpret_cast<const unsigned char*>(src);
+    __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(n, _mm_set1_epi8(9)), _mm_set1_epi8(39));
+    return _mm_add_epi8(_mm_add_epi8(n, _mm_set1_epi8('0')), letter);
+}
+
+SNIPER_TARGET("avx2") inline __m256i nibble2hex_avx2(__m256i n) noexcept
+{
+    __m256i letter = _mm256_and_si256(_mm256_cmpgt_epi8(n, _mm256_set1_epi8(9)), _mm256_set1_epi8(39));
+    return _mm256_add_epi8(_mm256_add_epi8(n, _mm256_set1_epi8('0')), letter);
+}
+
+// Same as DecLookup: digits and both letter cases, anything else is zero
+inline __m128i hex2nibble_sse2(__m128i c) noexcept
+{
+    __m128i digit = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), c));
+
+    __m128i lc = _mm_or_si128(c, _mm_set1_epi8(0x20));
+    __m128i letter = _mm_sub_epi8(lc, _mm_set1_epi8('a' - 10));
+    __m128i is_letter = _mm_and_si128(_mm_cmpgt_epi8(lc, _mm_set1_epi8('a' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('f' + 1), lc));
+
+    return _mm_or_si128(_mm_and_si128(digit, is_digit), _mm_and_si128(letter, is_letter));
+}
+
+SNIPER_TARGET("avx2") inline __m256i hex2nibble_avx2(__m256i c) noexcept
+{
+    __m256i digit = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+    __m256i is_digit =
+        _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), c));
+
+    __m256i lc = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
+    __m256i letter = _mm256_sub_epi8(lc, _mm256_set1_epi8('a' - 10));
+    __m256i is_letter =
+        _mm256_and_si256(_mm256_cmpgt_epi8(lc, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('f' + 1), lc));
 
-    size_t dst_len = 0;
-    for (size_t i = 0; i < len; i += 2) {
-        unsigned char d = DecLookup[data[i]] << 4u;
-        d |= DecLookup[data[i + 1]];
+    return _mm256_or_si256(_mm256_and_si256(digit, is_digit), _mm256_and_si256(letter, is_letter));
+}
+
+inline __m128i pack_nibbles_sse2(__m128i n) noexcept
+{
+    // high nibble is the even char, low nibble is the odd one
+    return _mm_or_si128(_mm_slli_epi16(_mm_and_si128(n, _mm_set1_epi16(0x00ff)), 4), _mm_srli_epi16(n, 8));
+}
+
+SNIPER_TARGET("avx2") inline __m256i pack_nibbles_avx2(__m256i n) noexcept
+{
+    return _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(n, _mm256_set1_epi16(0x00ff)), 4), _mm256_srli_epi16(n, 8));
+}
+
+// 16 bytes to 32 hex chars
+inline void bin2hex16_sse2(const unsigned char* src, char* dst) noexcept
+{
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    __m128i hi = nibble2hex_sse2(_mm_and_si128(_mm_srli_epi16(b, 4), _mm_set1_epi8(0x0f)));
+    __m128i lo = nibble2hex_sse2(_mm_and_si128(b, _mm_set1_epi8(0x0f)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_unpacklo_epi8(hi, lo));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), _mm_unpackhi_epi8(hi, lo));
+}
+
+// 32 hex chars to 16 bytes
+inline void hex2bin16_sse2(const unsigned char* src, unsigned char* dst) noexcept
+{
+    __m128i a = pack_nibbles_sse2(hex2nibble_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src))));
+    __m128i b = pack_nibbles_sse2(hex2nibble_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16))));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(a, b));
+}
+
+// Kernels start at src[from], take len >= one SSE block and finish with an overlapping last block
+void bin2hex_sse2(const unsigned char* src, size_t len, char* dst, size_t from = 0) noexcept
+{
+    size_t i = from;
+    for (; i + 16 <= len; i += 16)
+        bin2hex16_sse2(src + i, dst + i * 2);
 
-        dst[dst_len] = d;
-        dst_len++;
+    if (i != len)
+        bin2hex16_sse2(src + len - 16, dst + (len - 16) * 2);
+}
+
+void hex2bin_sse2(const unsigned char* src, size_t len, unsigned char* dst, size_t from = 0) noexcept
+{
+    size_t pairs = len & ~size_t(1);
+    size_t i = from;
+    for (; i + 32 <= pairs; i += 32)
+        hex2bin16_sse2(src + i, dst + i / 2);
+
+    if (i != pairs)
+        hex2bin16_sse2(src + pairs - 32, dst + (pairs - 32) / 2);
+
+    if (len & 1u)
+        dst[len / 2] = DecLookup[src[len - 1]] << 4u;
+}
+
+// AVX2 kernels return where the SSE2 tail starts
+SNIPER_TARGET("avx2") size_t bin2hex_avx2(const unsigned char* src, size_t len, char* dst) noexcept
+{
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i hi = nibble2hex_avx2(_mm256_and_si256(_mm256_srli_epi16(b, 4), _mm256_set1_epi8(0x0f)));
+        __m256i lo = nibble2hex_avx2(_mm256_and_si256(b, _mm256_set1_epi8(0x0f)));
+        // unpack works within 128-bit lanes: x is src[0-7, 16-23], y is src[8-15, 24-31]
+        __m256i x = _mm256_unpacklo_epi8(hi, lo);
+        __m256i y = _mm256_unpackhi_epi8(hi, lo);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 2), _mm256_permute2x128_si256(x, y, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 2 + 32), _mm256_permute2x128_si256(x, y, 0x31));
     }
 
-    return dst_len;
+    return i;
+}
+
+SNIPER_TARGET("avx2") size_t hex2bin_avx2(const unsigned char* src, size_t len, unsigned char* dst) noexcept
+{
+    size_t pairs = len & ~size_t(1);
+    size_t i = 0;
+    for (; i + 64 <= pairs; i += 64) {
+        __m256i a = pack_nibbles_avx2(hex2nibble_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i))));
+        __m256i b = pack_nibbles_avx2(hex2nibble_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 32))));
+        // packus works within 128-bit lanes too
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i / 2), _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xd8));
+    }
+
+    return i;
+}
+#endif
+
+} // namespace
+
+void bin2hex(const unsigned char* src, size_t len, char* dst) noexcept
+{
+#ifdef SNIPER_STRINGS_X86
+    if (len >= 32 && simd::level() == simd::Level::AVX2)
+        return bin2hex_sse2(src, len, dst, bin2hex_avx2(src, len, dst));
+
+    if (len >= 16 && simd::level() != simd::Level::Scalar)
+        return bin2hex_sse2(src, len, dst);
+#endif
+
+    bin2hex_scalar(src, len, dst);
+}
+
+void bin2hex_append(const unsigned char* src, size_t len, string& dst) noexcept
+{
+    size_t pos = dst.size();
+    dst.resize(pos + len * 2);
+    bin2hex(src, len, dst.data() + pos);
+}
+
+size_t hex2bin(const char* src, size_t len, unsigned char* dst) noexcept
+{
+    auto* data = reinterpret_cast<const unsigned char*>(src);
+
+#ifdef SNIPER_STRINGS_X86
+    if (len >= 64 && simd::level() == simd::Level::AVX2)
+        hex2bin_sse2(data, len, dst, hex2bin_avx2(data, len, dst));
+    else if (len >= 32 && simd::level() != simd::Level::Scalar)
+        hex2bin_sse2(data, len, dst);
+    else
+        hex2bin_scalar(data, len, dst);
+#else
+    hex2bin_scalar(data, len, dst);
+#endif
+
+    return hex2bin_size(len);
 }
 
 tuple<size_t, size_t> hex2bin_append(string_view src, string& dst)
 {
-    auto* data = reinterpret_cast<const unsigned char*>(src.data());
-    size_t src_len = src.length();
     size_t start_size = dst.size();
+    dst.resize(start_size + hex2bin_size(src.size()));
+    size_t len = hex2bin(src.data(), src.size(), reinterpret_cast<unsigned char*>(dst.data() + start_size));
 
-    for (size_t i = 0; i < src_len; i += 2) {
-        unsigned char d = DecLookup[data[i]] << 4u;
-        d |= DecLookup[data[i + 1]];
-        dst.push_back(d);
-    }
-
-    return std::make_tuple(start_size, dst.size() - start_size);
+    return std::make_tuple(start_size, len);
 }
 
 } // namespace sniper::strings
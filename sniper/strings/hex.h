@@ -25,7 +25,8 @@ namespace sniper::strings {
 // dst size should be at least 2x src size
 void bin2hex(const unsigned char* src, size_t len, char* dst) noexcept;
 
-// dst size should be at least 1/2 src size
+// dst size should be at least 1/2 src size (rounded up), invalid digits decode as zero,
+// odd src size gives a zero low nibble in the last byte
 size_t hex2bin(const char* src, size_t len, unsigned char* dst) noexcept;
 
 template<size_t SIZE>
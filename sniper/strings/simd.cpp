@@ -0,0 +1,46 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "simd.h"
+
+namespace sniper::strings::simd {
+
+namespace detail {
+Level current = Level::Scalar;
+} // namespace detail
+
+namespace {
+[[maybe_unused]] const Level detected = set_level(Level::AVX2);
+} // namespace
+
+Level set_level(Level max) noexcept
+{
+    Level l = Level::Scalar;
+#ifdef SNIPER_STRINGS_X86
+    __builtin_cpu_init();
+    if (max >= Level::AVX2 && __builtin_cpu_supports("avx2"))
+        l = Level::AVX2;
+    else if (max >= Level::SSE2)
+        l = Level::SSE2;
+#endif
+    detail::current = l;
+    return l;
+}
+
+} // namespace sniper::strings::simd
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+// SSE2 is the x86-64 baseline, wider kernels are built with target attributes and picked at runtime
+#if defined(__x86_64__) && defined(__GNUC__)
+#define SNIPER_STRINGS_X86 1
+#define SNIPER_TARGET(t) __attribute__((target(t)))
+#include <immintrin.h>
+#endif
+
+namespace sniper::strings::simd {
+
+enum class Level : uint8_t
+{
+    Scalar = 0,
+    SSE2,
+    AVX2
+};
+
+namespace detail {
+extern Level current;
+} // namespace detail
+
+// Kernels in use. Scalar until static initialization of the library is done.
+[[nodiscard]] inline Level level() noexcept
+{
+    return detail::current;
+}
+
+// Selects the best supported level not above max and returns it. For benchmarks: not thread safe against running
+// kernels.
+Level set_level(Level max) noexcept;
+
+} // namespace sniper::strings::simd
@@ -18,6 +18,7 @@
 
 #include <sniper/std/string.h>
 #include <sniper/std/vector.h>
+#include <sniper/strings/find.h>
 
 namespace sniper::strings {
 
@@ -29,11 +30,11 @@ inline bool split(string_view str, string_view delim, Container& out)
     if (str.empty() || delim.empty())
         return false;
 
-    size_t pos = str.find_first_of(delim);
+    size_t pos = find_first_of(str, delim);
     if (pos == string_view::npos)
         return false;
 
-    for (; pos != string_view::npos; pos = str.find_first_of(delim)) {
+    for (; pos != string_view::npos; pos = find_first_of(str, delim)) {
         if (!pos)
             out.emplace_back();
         else
@@ -55,11 +56,11 @@ inline bool split(string_view str, string_view delim, Container& out, size_t max
     if (str.empty() || delim.empty())
         return false;
 
-    size_t pos = str.find_first_of(delim);
+    size_t pos = find_first_of(str, delim);
     if (pos == string_view::npos)
         return false;
 
-    for (; pos != string_view::npos; pos = str.find_first_of(delim)) {
+    for (; pos != string_view::npos; pos = find_first_of(str, delim)) {
         if (out.size() == max_size)
             return false;
 
@@ -18,6 +18,7 @@
  * limitations under the License.
  */
 
+#include "simd.h"
 #include "trim.h"
 
 namespace sniper::strings {
@@ -29,10 +30,52 @@ inline bool is_oddspace(char c)
     return c == '\n' || c == '\t' || c == '\r';
 }
 
+#ifdef SNIPER_STRINGS_X86
+// Whitespace runs are short, so 16 byte blocks are enough and there is no AVX2 variant.
+// Bit set for each char of the block that is not whitespace.
+inline unsigned not_space_sse2(const char* p) noexcept
+{
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))),
+                              _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+    return ~unsigned(_mm_movemask_epi8(ws)) & 0xffffu;
+}
+
+string_view trim_left_sse2(string_view sp) noexcept
+{
+    while (sp.size() >= 16) {
+        if (unsigned m = not_space_sse2(sp.data()); m) {
+            sp.remove_prefix(__builtin_ctz(m));
+            return sp;
+        }
+        sp.remove_prefix(16);
+    }
+    return sp;
+}
+
+string_view trim_right_sse2(string_view sp) noexcept
+{
+    while (sp.size() >= 16) {
+        if (unsigned m = not_space_sse2(sp.data() + sp.size() - 16); m) {
+            sp.remove_suffix(__builtin_clz(m) - 16);
+            return sp;
+        }
+        sp.remove_suffix(16);
+    }
+    return sp;
+}
+#endif
+
 } // namespace
 
 string_view trim_left(string_view sp)
 {
+#ifdef SNIPER_STRINGS_X86
+    // the loop below finishes a tail shorter than a block
+    if (sp.size() >= 16 && simd::level() != simd::Level::Scalar)
+        sp = trim_left_sse2(sp);
+#endif
+
     // Spaces other than ' ' characters are less common but should be
     // checked.  This configuration where we loop on the ' '
     // separately from oddspaces was empirically fastest.
@@ -52,6 +95,12 @@ string_view trim_left(string_view sp)
 
 string_view trim_right(string_view sp)
 {
+#ifdef SNIPER_STRINGS_X86
+    // the loop below finishes a tail shorter than a block
+    if (sp.size() >= 16 && simd::level() != simd::Level::Scalar)
+        sp = trim_right_sse2(sp);
+#endif
+
     // Spaces other than ' ' characters are less common but should be
     // checked.  This configuration where we loop on the ' '
     // separately from oddspaces was empirically fastest.
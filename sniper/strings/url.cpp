@@ -0,0 +1,62 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "url.h"
+
+namespace sniper::strings {
+
+namespace {
+
+inline int hex_digit(char c) noexcept
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+
+    return -1;
+}
+
+} // namespace
+
+size_t url_decode(string_view src, char* dst) noexcept
+{
+    size_t len = 0;
+
+    for (size_t i = 0; i < src.size(); i++) {
+        if (src[i] == '+') {
+            dst[len++] = ' ';
+        }
+        else if (src[i] == '%' && i + 2 < src.size() && hex_digit(src[i + 1]) >= 0 && hex_digit(src[i + 2]) >= 0) {
+            dst[len++] = static_cast<char>(hex_digit(src[i + 1]) << 4 | hex_digit(src[i + 2]));
+            i += 2;
+        }
+        else {
+            dst[len++] = src[i];
+        }
+    }
+
+    return len;
+}
+
+} // namespace sniper::strings
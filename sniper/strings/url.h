@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sniper/std/string.h>
+#include <sniper/strings/find.h>
+
+namespace sniper::strings {
+
+// Percent-decoding of url component, '+' is space. Invalid escapes are copied as is.
+// dst size should be at least src size, returns decoded size.
+size_t url_decode(string_view src, char* dst) noexcept;
+
+[[nodiscard]] inline bool is_url_encoded(string_view src) noexcept
+{
+    return find_first_of(src, "%+") != string_view::npos;
+}
+
+} // namespace sniper::strings
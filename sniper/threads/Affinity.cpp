@@ -0,0 +1,110 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fmt/format.h>
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
+#include <sniper/strings/atoi.h>
+#include <sniper/strings/trim.h>
+#include "Affinity.h"
+
+namespace sniper::threads {
+
+vector<unsigned> parse_cpu_list(string_view str)
+{
+    vector<unsigned> out;
+
+    str = strings::trim(str);
+    while (!str.empty()) {
+        string_view item = str;
+        if (auto pos = str.find(','); pos != string_view::npos) {
+            item = str.substr(0, pos);
+            str.remove_prefix(pos + 1);
+        }
+        else {
+            str = {};
+        }
+
+        item = strings::trim(item);
+        if (item.empty())
+            continue;
+
+        string_view first = item;
+        string_view last = item;
+        if (auto pos = item.find('-'); pos != string_view::npos) {
+            first = item.substr(0, pos);
+            last = item.substr(pos + 1);
+        }
+
+        auto from = strings::fast_atoi32(first);
+        auto to = strings::fast_atoi32(last);
+        if (!from || !to || *from < 0 || *to < *from)
+            return {};
+
+        for (int32_t cpu = *from; cpu <= *to; cpu++)
+            out.emplace_back(cpu);
+    }
+
+    return out;
+}
+
+vector<unsigned> numa_node_cpus(unsigned node)
+{
+    std::ifstream in(fmt::format("/sys/devices/system/node/node{}/cpulist", node));
+    if (!in)
+        return {};
+
+    string line;
+    std::getline(in, line);
+
+    return parse_cpu_list(line);
+}
+
+bool set_affinity(const vector<unsigned>& cpus) noexcept
+{
+    if (cpus.empty())
+        return false;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    for (auto cpu : cpus) {
+        if (cpu >= CPU_SETSIZE)
+            return false;
+
+        CPU_SET(cpu, &set);
+    }
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+bool set_affinity(unsigned cpu) noexcept
+{
+    if (cpu >= CPU_SETSIZE)
+        return false;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+} // namespace sniper::threads
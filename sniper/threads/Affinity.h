@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2020, RTBtech, MediaSniper, Oleg Romanenko (oleg@romanenko.ro)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sniper/std/string.h>
+#include <sniper/std/vector.h>
+
+namespace sniper::threads {
+
+// "0-3,8,10-11" -> {0, 1, 2, 3, 8, 10, 11}
+[[nodiscard]] vector<unsigned> parse_cpu_list(string_view str);
+
+// cpus of NUMA node from /sys/devices/system/node/nodeN/cpulist, empty on error
+[[nodiscard]] vector<unsigned> numa_node_cpus(unsigned node);
+
+// pin current thread to cpus
+[[nodiscard]] bool set_affinity(const vector<unsigned>& cpus) noexcept;
+[[nodiscard]] bool set_affinity(unsigned cpu) noexcept;
+
+} // namespace sniper::threads